@@ -1 +1,3 @@
 #include "../../../src/logger/qtlogger-handler.h"
+#include "../../../src/logger/deferred.h"
+#include "../../../src/logger/scope.h"
@@ -0,0 +1,114 @@
+#include "call-site-stats.h"
+
+#include <algorithm>
+
+namespace qtlogger {
+
+void CallSiteStats::hit(const QMessageLogContext &context, bool emitted, int bytes)
+{
+    Slot *slot = find(context);
+    if (!slot) {
+        return;
+    }
+
+    if (emitted)
+    {
+        slot->emitted.fetch_add(1, std::memory_order_relaxed);
+        slot->emittedBytes.fetch_add(quint64(bytes), std::memory_order_relaxed);
+    }
+    else
+    {
+        slot->filtered.fetch_add(1, std::memory_order_relaxed);
+        slot->filteredBytes.fetch_add(quint64(bytes), std::memory_order_relaxed);
+    }
+}
+
+QVector<CallSiteStats::Site> CallSiteStats::top(int count)
+{
+    const quint64 nowNs = Timestamp::now();
+    const double seconds = qMax(1e-3, (nowNs - lastTopNs) / 1e9);
+    lastTopNs = nowNs;
+
+    QVector<Site> sites;
+    for (Slot &slot : table)
+    {
+        if (!slot.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+
+        Site site;
+        site.file = slot.file;
+        site.function = slot.function;
+        site.line = slot.line;
+        site.emitted = slot.emitted.load(std::memory_order_relaxed);
+        site.filtered = slot.filtered.load(std::memory_order_relaxed);
+        site.emittedBytes = slot.emittedBytes.load(std::memory_order_relaxed);
+        site.filteredBytes = slot.filteredBytes.load(std::memory_order_relaxed);
+
+        const quint64 hits = site.emitted + site.filtered;
+        const quint64 bytes = site.emittedBytes + site.filteredBytes;
+        site.hitRate = (hits - slot.lastHits) / seconds;
+        site.byteRate = (bytes - slot.lastBytes) / seconds;
+        slot.lastHits = hits;
+        slot.lastBytes = bytes;
+
+        sites.append(site);
+    }
+
+    std::sort(sites.begin(), sites.end(), [](const Site &a, const Site &b) -> bool
+    {
+        return (a.hitRate != b.hitRate ? a.hitRate > b.hitRate
+                                       : a.emitted + a.filtered > b.emitted + b.filtered);
+    });
+    if (sites.size() > count) {
+        sites.resize(qMax(0, count));
+    }
+    return sites;
+}
+
+quint64 CallSiteStats::overflow() const
+{
+    return overflowHits.load(std::memory_order_relaxed);
+}
+
+CallSiteStats::Slot * CallSiteStats::find(const QMessageLogContext &context)
+{
+    quint64 key = quint64(quintptr(context.file)) * 0x9E3779B97F4A7C15ull
+                ^ quint64(quintptr(context.function)) * 0xC2B2AE3D27D4EB4Full
+                ^ quint64(quint32(context.line)) * 0x165667B19E3779F9ull;
+    key ^= key >> 31;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 29;
+    if (key == 0) {
+        key = 1;
+    }
+
+    // Bounded so that a full table costs untracked sites a few probes, not a scan
+    for (int probe = 0; probe < MaxProbes; ++probe)
+    {
+        Slot &slot = table[(key + quint64(probe)) & (Capacity - 1)];
+        quint64 current = slot.key.load(std::memory_order_acquire);
+        if (current == 0 && slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+        {
+            slot.file = context.file;
+            slot.function = context.function;
+            slot.line = context.line;
+            slot.ready.store(true, std::memory_order_release);
+            return &slot;
+        }
+
+        if (current != key) {
+            continue;
+        }
+
+        while (!slot.ready.load(std::memory_order_acquire)) {}
+        if (slot.file == context.file && slot.function == context.function && slot.line == context.line) {
+            return &slot;
+        }
+    }
+
+    overflowHits.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+}
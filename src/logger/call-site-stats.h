@@ -0,0 +1,65 @@
+#ifndef QTLOGGER_CALLSITESTATS_H
+#define QTLOGGER_CALLSITESTATS_H
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+#include "timestamp.h"
+
+namespace qtlogger {
+
+class CallSiteStats {
+public:
+    enum {
+        Capacity = 4096,
+        MaxProbes = 16
+    };
+
+    struct Site {
+        const char *file;
+        const char *function;
+        int line;
+        quint64 emitted;
+        quint64 filtered;
+        quint64 emittedBytes;
+        quint64 filteredBytes;
+        double hitRate;
+        double byteRate;
+    };
+
+public:
+    void hit(const QMessageLogContext &context, bool emitted, int bytes);
+
+    QVector<Site> top(int count);
+    quint64 overflow() const;
+
+private:
+    struct Slot {
+        std::atomic<quint64> key { 0 };
+        std::atomic<bool> ready { false };
+        const char *file = nullptr;
+        const char *function = nullptr;
+        int line = 0;
+
+        std::atomic<quint64> emitted { 0 };
+        std::atomic<quint64> filtered { 0 };
+        std::atomic<quint64> emittedBytes { 0 };
+        std::atomic<quint64> filteredBytes { 0 };
+
+        quint64 lastHits = 0;
+        quint64 lastBytes = 0;
+    };
+
+    Slot * find(const QMessageLogContext &context);
+
+private:
+    Slot table[Capacity];
+    std::atomic<quint64> overflowHits { 0 };
+    quint64 lastTopNs = Timestamp::now();
+};
+
+}
+
+#endif // QTLOGGER_CALLSITESTATS_H
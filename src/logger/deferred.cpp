@@ -0,0 +1,264 @@
+#include "deferred.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QString>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+
+namespace qtlogger {
+namespace deferred {
+
+namespace {
+
+QString valueString(Type type, const Value &value)
+{
+    switch (type)
+    {
+        case Type::Int:     return QString::number(value.i);
+        case Type::UInt:    return QString::number(value.u);
+        case Type::Double:  return QString::number(value.d);
+        case Type::Bool:    return QString(value.u ? "true" : "false");
+        case Type::Char:    return QString(QChar::fromLatin1(char(value.u)));
+        case Type::Pointer: return QString("0x%1").arg(quintptr(value.p), QT_POINTER_SIZE * 2, 16, QChar('0'));
+    }
+    return QString();
+}
+
+QString formatString(const Record &record)
+{
+    QString string;
+    int arg = 0;
+    const char *run = record.format;
+    for (const char *c = record.format; *c != '\0'; ++c)
+    {
+        if (c[0] == '{' && c[1] == '}' && arg < record.argc)
+        {
+            string.append(QString::fromUtf8(run, int(c - run)));
+            string.append(valueString(record.types[arg], record.args[arg]));
+            ++arg;
+            run = ++c + 1;
+        }
+    }
+    string.append(QString::fromUtf8(run));
+    return string;
+}
+
+void dispatch(const Record &record)
+{
+    const QString &msg = formatString(record);
+    const QMessageLogContext context(record.file, record.line, record.function, "default");
+    switch (record.type)
+    {
+        case QtDebugMsg:    Logger::debug(msg, context, record.timestamp);
+            break;
+        case QtInfoMsg:     Logger::info(msg, context, record.timestamp);
+            break;
+        case QtWarningMsg:  Logger::warning(msg, context, record.timestamp);
+            break;
+        case QtCriticalMsg: Logger::critical(msg, context, record.timestamp);
+            break;
+        case QtFatalMsg:    Logger::fatal(msg, context, record.timestamp);
+            break;
+    }
+}
+
+class Backend {
+public:
+    static Backend & instance()
+    {
+        static Backend backend;
+        return backend;
+    }
+
+    ~Backend()
+    {
+        stopping.store(true);
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCondition.notify_one();
+        }
+        if (thread.joinable()) {
+            thread.join();
+        }
+        for (Ring *ring : rings) {
+            delete ring;
+        }
+    }
+
+    Ring * attach()
+    {
+        Ring *ring = new Ring;
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.push_back(ring);
+        if (!thread.joinable()) {
+            thread = std::thread(&Backend::run, this);
+        }
+        return ring;
+    }
+
+    void setReady()
+    {
+        ready.store(true);
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+    }
+
+    // Producers skip the full fence, a wake-up lost to reordering is picked up by the idle timeout
+    void wake()
+    {
+        if (waiting.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCondition.notify_one();
+        }
+    }
+
+private:
+    Backend() = default;
+
+    void run()
+    {
+        while (!stopping.load())
+        {
+            if (!ready.load()) {
+                requestLogger();
+            } else if (drain()) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!stopping.load() && !(ready.load() && pending())) {
+                wakeCondition.wait_for(lock, std::chrono::milliseconds(IdleTimeoutMs));
+            }
+            waiting.store(false, std::memory_order_relaxed);
+        }
+        if (ready.load()) {
+            drain();
+        }
+    }
+
+    // Logger must be created in the QCoreApplication thread, never here
+    void requestLogger()
+    {
+        if (loggerRequested || !qApp) {
+            return;
+        }
+        loggerRequested = true;
+        QMetaObject::invokeMethod(qApp, [] {
+            Logger::exec(QString());
+            Backend::instance().setReady();
+        }, Qt::QueuedConnection);
+    }
+
+    bool pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Ring *ring : rings)
+        {
+            if (ring->front() || ring->abandoned.load(std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool drain()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            snapshot = rings;
+        }
+
+        bool drained = false;
+        finished.clear();
+        for (Ring *ring : snapshot)
+        {
+            const bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+            while (const Record *record = ring->front())
+            {
+                dispatch(*record);
+                ring->pop();
+                drained = true;
+            }
+
+            const quint64 dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                Logger::warning(QString("%1 deferred messages dropped, logging thread outpaced formatting").arg(dropped), QMessageLogContext());
+            }
+
+            if (abandoned) {
+                finished.push_back(ring);
+            }
+        }
+
+        if (!finished.empty())
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Ring *ring : finished) {
+                rings.erase(std::find(rings.begin(), rings.end(), ring));
+                delete ring;
+            }
+        }
+        return drained;
+    }
+
+private:
+    enum { IdleTimeoutMs = 100 };
+
+    std::mutex mutex;
+    std::vector<Ring *> rings;
+    std::vector<Ring *> snapshot;
+    std::vector<Ring *> finished;
+    std::thread thread;
+    std::atomic<bool> stopping { false };
+    std::atomic<bool> ready { false };
+    bool loggerRequested = false;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<bool> waiting { false };
+};
+
+struct RingHolder {
+    Ring *ring = nullptr;
+    ~RingHolder()
+    {
+        if (ring) {
+            ring->abandoned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+}
+
+Ring * localRing()
+{
+    static thread_local RingHolder holder;
+    if (!holder.ring)
+    {
+        if (qApp && QThread::currentThread() == qApp->thread()) {
+            Logger::exec(QString());
+            Backend::instance().setReady();
+        }
+        holder.ring = Backend::instance().attach();
+    }
+    return holder.ring;
+}
+
+void wake()
+{
+    Backend::instance().wake();
+}
+
+}
+}
@@ -0,0 +1,204 @@
+#ifndef QTLOGGER_DEFERRED_H
+#define QTLOGGER_DEFERRED_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <type_traits>
+
+#include "timestamp.h"
+
+#define QTLOG_DEBUG(format, ...)    QTLOG_DEFERRED(QtDebugMsg, format, ##__VA_ARGS__)
+#define QTLOG_INFO(format, ...)     QTLOG_DEFERRED(QtInfoMsg, format, ##__VA_ARGS__)
+#define QTLOG_WARNING(format, ...)  QTLOG_DEFERRED(QtWarningMsg, format, ##__VA_ARGS__)
+#define QTLOG_CRITICAL(format, ...) QTLOG_DEFERRED(QtCriticalMsg, format, ##__VA_ARGS__)
+
+#define QTLOG_DEFERRED(type, format, ...) \
+    do { \
+        static_assert(qtlogger::deferred::placeholders(format) == decltype(qtlogger::deferred::arity(__VA_ARGS__))::value, \
+                      "Number of {} placeholders in format string does not match number of arguments"); \
+        qtlogger::deferred::post(type, format, __FILE__, __LINE__, Q_FUNC_INFO, ##__VA_ARGS__); \
+    } while (false)
+
+namespace qtlogger {
+namespace deferred {
+
+enum {
+    MaxArgs =      8,
+    RingCapacity = 2048
+};
+
+enum class Type : quint8 {
+    Int,
+    UInt,
+    Double,
+    Bool,
+    Char,
+    Pointer
+};
+
+union Value {
+    qint64 i;
+    quint64 u;
+    double d;
+    const void *p;
+};
+
+struct Record {
+    const char *format;
+    const char *file;
+    const char *function;
+    int line;
+    quint64 timestamp;
+    QtMsgType type;
+    quint8 argc;
+    Type types[MaxArgs];
+    Value args[MaxArgs];
+};
+
+class Ring {
+public:
+    Record * claim()
+    {
+        const quint32 head = writeIndex.load(std::memory_order_relaxed);
+        if (head - cachedReadIndex >= quint32(RingCapacity))
+        {
+            cachedReadIndex = readIndex.load(std::memory_order_acquire);
+            if (head - cachedReadIndex >= quint32(RingCapacity)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return &records[head & (RingCapacity - 1)];
+    }
+
+    void publish()
+    {
+        writeIndex.store(writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    const Record * front() const
+    {
+        const quint32 tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == writeIndex.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &records[tail & (RingCapacity - 1)];
+    }
+
+    void pop()
+    {
+        readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+public:
+    std::atomic<quint64> dropped { 0 };
+    std::atomic<bool> abandoned { false };
+
+private:
+    std::atomic<quint32> writeIndex { 0 };
+    quint32 cachedReadIndex = 0;
+    char writerPadding[64];
+    std::atomic<quint32> readIndex { 0 };
+    char readerPadding[64];
+    Record records[RingCapacity];
+};
+
+Ring * localRing();
+void wake();
+
+constexpr int placeholders(const char *format)
+{
+    return (*format == '\0') ? 0
+         : (format[0] == '{' && format[1] == '}') ? 1 + placeholders(format + 2)
+         : placeholders(format + 1);
+}
+
+template<typename... Args>
+struct Arity { enum { value = sizeof...(Args) }; };
+
+template<typename... Args>
+Arity<Args...> arity(const Args &...);
+
+template<typename T>
+struct Unsupported : std::false_type {};
+
+template<typename T, typename Enable = void>
+struct Arg {
+    static_assert(Unsupported<T>::value, "QTLOG_* arguments should be arithmetic, enum or non-char pointer values, "
+                                         "put constant text into format string or use qDebug() for strings");
+    static void encode(const T &, Type *, Value *) {}
+};
+
+template<>
+struct Arg<bool> {
+    static void encode(bool arg, Type *type, Value *value) { *type = Type::Bool; value->u = arg; }
+};
+
+template<>
+struct Arg<char> {
+    static void encode(char arg, Type *type, Value *value) { *type = Type::Char; value->u = quint8(arg); }
+};
+
+template<typename T>
+struct Arg<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && !std::is_same<T, char>::value>::type> {
+    static void encode(T arg, Type *type, Value *value) { *type = Type::Int; value->i = arg; }
+};
+
+template<typename T>
+struct Arg<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type> {
+    static void encode(T arg, Type *type, Value *value) { *type = Type::UInt; value->u = arg; }
+};
+
+template<typename T>
+struct Arg<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void encode(T arg, Type *type, Value *value) { *type = Type::Double; value->d = double(arg); }
+};
+
+template<typename T>
+struct Arg<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+    static void encode(T arg, Type *type, Value *value) { *type = Type::Int; value->i = qint64(arg); }
+};
+
+template<typename T>
+struct Arg<T *, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+    static void encode(T *arg, Type *type, Value *value) { *type = Type::Pointer; value->p = arg; }
+};
+
+inline void encode(Record *, int)
+{}
+
+template<typename T, typename... Rest>
+inline void encode(Record *record, int index, const T &arg, const Rest &... rest)
+{
+    Arg<T>::encode(arg, &record->types[index], &record->args[index]);
+    encode(record, index + 1, rest...);
+}
+
+template<typename... Args>
+inline void post(QtMsgType type, const char *format, const char *file, int line, const char *function, const Args &... args)
+{
+    static_assert(sizeof...(Args) <= MaxArgs, "QTLOG_* supports up to 8 arguments");
+
+    Ring *ring = localRing();
+    Record *record = ring->claim();
+    if (!record) {
+        return;
+    }
+
+    record->format = format;
+    record->file = file;
+    record->function = function;
+    record->line = line;
+    record->timestamp = Timestamp::now();
+    record->type = type;
+    record->argc = quint8(sizeof...(Args));
+    encode(record, 0, args...);
+    ring->publish();
+    wake();
+}
+
+}
+}
+
+#endif // QTLOGGER_DEFERRED_H
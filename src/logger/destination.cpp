@@ -0,0 +1,62 @@
+#include "destination.h"
+
+#include <QStringList>
+
+namespace qtlogger {
+
+bool parseDestination(const QString &destination, QHostAddress *address, quint16 *port)
+{
+    QString host;
+    QString service;
+    if (destination.startsWith('['))
+    {
+        const int end = destination.indexOf(']');
+        if (end < 0 || (end + 1 < destination.size() && destination.at(end + 1) != ':')) {
+            return false;
+        }
+        host = destination.mid(1, end - 1);
+        service = destination.mid(end + 2);
+        if (host.isEmpty()) {
+            return false;
+        }
+    }
+    else if (destination.count(':') > 1)
+    {
+        host = destination;
+    }
+    else
+    {
+        const auto &tupple = destination.split(":");
+        if (tupple.size() > 2) {
+            return false;
+        }
+
+        bool isPort = false;
+        tupple.first().toUShort(&isPort);
+        if (tupple.size() == 2) {
+            host = tupple.first();
+            service = tupple.last();
+        } else if (isPort) {
+            service = tupple.first();
+        } else {
+            host = tupple.first();
+        }
+    }
+
+    QHostAddress parsedAddress;
+    if (!host.isEmpty() && !parsedAddress.setAddress(host)) {
+        return false;
+    }
+
+    bool isPort = service.isEmpty();
+    const quint16 parsedPort = (isPort ? 0 : service.toUShort(&isPort));
+    if (!isPort) {
+        return false;
+    }
+
+    if (address && !host.isEmpty()) { *address = parsedAddress; }
+    if (port && !service.isEmpty()) { *port = parsedPort; }
+    return true;
+}
+
+}
@@ -0,0 +1,16 @@
+#ifndef QTLOGGER_DESTINATION_H
+#define QTLOGGER_DESTINATION_H
+
+#include <QHostAddress>
+#include <QString>
+
+namespace qtlogger {
+
+// Parses "[address:][port]", IPv6 address is bracketed when a port follows
+// ("[ff15::1]:6061"). Fields missing in destination keep their values,
+// malformed input leaves both untouched and returns false.
+bool parseDestination(const QString &destination, QHostAddress *address, quint16 *port);
+
+}
+
+#endif // QTLOGGER_DESTINATION_H
@@ -0,0 +1,157 @@
+#include "load-shedder.h"
+
+#include "timestamp.h"
+
+namespace qtlogger {
+
+namespace {
+
+const quint64 WindowNs = 1000000000ull;
+const double RecoveryRatio = 0.8;
+
+}
+
+void LoadShedder::setBudget(quint64 messagesPerSec, quint64 bytesPerSec)
+{
+    messageBudget.store(messagesPerSec, std::memory_order_relaxed);
+    byteBudget.store(bytesPerSec, std::memory_order_relaxed);
+    stage.store(None, std::memory_order_relaxed);
+    windowStartNs.store(Timestamp::now(), std::memory_order_relaxed);
+    shed.store(0, std::memory_order_relaxed);
+}
+
+bool LoadShedder::isEnabled() const
+{
+    return ( messageBudget.load(std::memory_order_relaxed) != 0 ||
+             byteBudget.load(std::memory_order_relaxed) != 0 );
+}
+
+bool LoadShedder::admit(Severity severity, int bytes, QString *notice)
+{
+    if (!isEnabled()) {
+        return true;
+    }
+
+    const quint64 nowNs = Timestamp::now();
+    quint64 startNs = windowStartNs.load(std::memory_order_relaxed);
+    if (nowNs - startNs >= WindowNs && windowStartNs.compare_exchange_strong(startNs, nowNs, std::memory_order_relaxed)) {
+        roll(nowNs - startNs, notice);
+    }
+
+    offeredMessages[severity].fetch_add(1, std::memory_order_relaxed);
+    offeredBytes[severity].fetch_add(quint64(bytes), std::memory_order_relaxed);
+
+    const int current = stage.load(std::memory_order_relaxed);
+    const bool dropped = ( severity < qMin(int(current), int(Warning)) ||
+                           (current == LimitWarnings && severity == Warning &&
+                            exceeds(admittedMessages.load(std::memory_order_relaxed) + 1,
+                                    admittedBytes.load(std::memory_order_relaxed) + quint64(bytes), 1.0)) );
+    if (dropped)
+    {
+        shed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const quint64 messages = admittedMessages.fetch_add(1, std::memory_order_relaxed) + 1;
+    const quint64 total = admittedBytes.fetch_add(quint64(bytes), std::memory_order_relaxed) + quint64(bytes);
+    if (current < LimitWarnings && exceeds(messages, total, 1.0))
+    {
+        // One stage further only while levels kept by the current stage alone
+        // already offer more than the budget in this window
+        quint64 keptMessages = 0;
+        quint64 keptBytes = 0;
+        for (int i = current; i < SeverityCount; ++i)
+        {
+            keptMessages += offeredMessages[i].load(std::memory_order_relaxed);
+            keptBytes += offeredBytes[i].load(std::memory_order_relaxed);
+        }
+        if (exceeds(keptMessages, keptBytes, 1.0)) {
+            changeStage(current, current + 1, notice);
+        }
+    }
+    return true;
+}
+
+QString LoadShedder::statusString() const
+{
+    if (!isEnabled()) {
+        return QString("Budget off");
+    }
+
+    return QString("Budget %1 msg/s %2 bytes/s, %3, %4 messages shed").arg(messageBudget.load(std::memory_order_relaxed))
+                                                                    .arg(byteBudget.load(std::memory_order_relaxed))
+                                                                    .arg(stageString(stage.load(std::memory_order_relaxed)))
+                                                                    .arg(shed.load(std::memory_order_relaxed));
+}
+
+bool LoadShedder::exceeds(quint64 messages, quint64 bytes, double ratio) const
+{
+    const quint64 messagesLimit = messageBudget.load(std::memory_order_relaxed);
+    const quint64 bytesLimit = byteBudget.load(std::memory_order_relaxed);
+    return ( (messagesLimit != 0 && messages > messagesLimit * ratio) ||
+             (bytesLimit != 0 && bytes > bytesLimit * ratio) );
+}
+
+void LoadShedder::roll(quint64 elapsedNs, QString *notice)
+{
+    quint64 messages[SeverityCount];
+    quint64 bytes[SeverityCount];
+    for (int i = 0; i < SeverityCount; ++i)
+    {
+        messages[i] = offeredMessages[i].exchange(0, std::memory_order_relaxed);
+        bytes[i] = offeredBytes[i].exchange(0, std::memory_order_relaxed);
+    }
+    admittedMessages.store(0, std::memory_order_relaxed);
+    admittedBytes.store(0, std::memory_order_relaxed);
+
+    // The lowest stage whose kept load fits the budget, leaving a stage only
+    // once the load it would let through is well below the budget. Window
+    // lasts until the first message after a second, so budget is scaled to it
+    const double seconds = double(elapsedNs) / WindowNs;
+    const int current = stage.load(std::memory_order_relaxed);
+    int wanted = None;
+    for (; wanted < LimitWarnings; ++wanted)
+    {
+        quint64 keptMessages = 0;
+        quint64 keptBytes = 0;
+        for (int i = wanted; i < SeverityCount; ++i)
+        {
+            keptMessages += messages[i];
+            keptBytes += bytes[i];
+        }
+        if (!exceeds(keptMessages, keptBytes, (wanted < current ? RecoveryRatio : 1.0) * seconds)) {
+            break;
+        }
+    }
+    changeStage(current, wanted, notice);
+}
+
+void LoadShedder::changeStage(int from, int to, QString *notice)
+{
+    if (from == to || !stage.compare_exchange_strong(from, to, std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (from == None)
+    {
+        *notice = QString("Logging exceeds budget of %1 msg/s %2 bytes/s, shedding started").arg(messageBudget.load(std::memory_order_relaxed))
+                                                                                             .arg(byteBudget.load(std::memory_order_relaxed));
+    }
+    else if (to == None)
+    {
+        *notice = QString("Logging is back within budget, shedding stopped, %1 messages shed").arg(shed.exchange(0, std::memory_order_relaxed));
+    }
+}
+
+QString LoadShedder::stageString(int stage)
+{
+    switch (stage) {
+        case None:          return QString("not shedding");
+        case ShedDebug:     return QString("shedding debug");
+        case ShedInfo:      return QString("shedding debug and info");
+        case LimitWarnings: return QString("shedding debug and info, rate limiting warnings");
+    }
+    return QString("N/D");
+}
+
+}
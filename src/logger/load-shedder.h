@@ -0,0 +1,57 @@
+#ifndef QTLOGGER_LOADSHEDDER_H
+#define QTLOGGER_LOADSHEDDER_H
+
+#include <QString>
+
+#include <atomic>
+
+namespace qtlogger {
+
+class LoadShedder {
+public:
+    enum Severity {
+        Debug,
+        Info,
+        Warning,
+        Critical,
+        Fatal,
+        SeverityCount
+    };
+    enum Stage {
+        None,
+        ShedDebug,
+        ShedInfo,
+        LimitWarnings
+    };
+
+public:
+    void setBudget(quint64 messagesPerSec, quint64 bytesPerSec);
+    bool isEnabled() const;
+
+    bool admit(Severity severity, int bytes, QString *notice);
+
+    QString statusString() const;
+
+private:
+    bool exceeds(quint64 messages, quint64 bytes, double ratio) const;
+    void roll(quint64 elapsedNs, QString *notice);
+    void changeStage(int from, int to, QString *notice);
+
+    static QString stageString(int stage);
+
+private:
+    std::atomic<quint64> messageBudget { 0 };
+    std::atomic<quint64> byteBudget { 0 };
+
+    std::atomic<int> stage { None };
+    std::atomic<quint64> windowStartNs { 0 };
+    std::atomic<quint64> offeredMessages[SeverityCount] {};
+    std::atomic<quint64> offeredBytes[SeverityCount] {};
+    std::atomic<quint64> admittedMessages { 0 };
+    std::atomic<quint64> admittedBytes { 0 };
+    std::atomic<quint64> shed { 0 };
+};
+
+}
+
+#endif // QTLOGGER_LOADSHEDDER_H
@@ -5,6 +5,14 @@
 #include <QTextStream>
 #include <QTimer>
 
+#include "call-site-stats.h"
+#include "load-shedder.h"
+#include "message-filter.h"
+#include "scope.h"
+#include "tcp-sink.h"
+#include "thread-file-sink.h"
+#include "timestamp.h"
+
 namespace qtlogger {
 
 class LoggerPrivate : public QObject {
@@ -22,7 +30,9 @@ public:
         Mute,
         StdErr,
         File,
-        Udp
+        Udp,
+        Tcp,
+        SplitFile
     };
 
 public:
@@ -40,10 +50,22 @@ public:
     QHostAddress echoDestAddress;
     quint16 echoDestPort = 0;
     quint16 defaultDestPort = 0;
+    int echoMulticastTtl = 1;
+    QString echoMulticastInterface;
+    int defaultMulticastTtl = 1;
+
+    TcpSink tcpSink;
+    ThreadFileSink threadFileSink;
 
     quint32 levelFilter = quint32(Level::All);
     QStringList fileFilter;
     QStringList funcFilter;
+    MessageFilter messageFilter;
+
+    CallSiteStats callSiteStats;
+    LoadShedder loadShedder;
+
+    QTimer scopeSummaryTimer;
 
     typedef void(*SignalHandler)(int);
     QMap<int,SignalHandler> originalSignalHandlers;
@@ -55,47 +77,59 @@ public:
 public:
     void configure();
 
-    void log(const QString &msg);
+    void log(const QString &msg, quint64 timestampNs = Timestamp::now());
     void exec(const QString &command, const QHostAddress &sender = QHostAddress());
     void processCommand(const QStringList &command, const QHostAddress &sender = QHostAddress());
 public:
+    bool passFilters(Level level, const QString &msg, const QMessageLogContext &context);
     bool passDestination(const QString &destination) const;
     bool passLevel(Level level) const;
     bool passFile(const QString &file) const;
     bool passFunc(const QString &func) const;
+    bool passMessage(const QString &msg) const;
+    bool passBudget(Level level, int bytes);
     QString statusString() const;
+    QString topString(int count);
+    QString scopesString() const;
 
     void resetSignals();
 
-    static QString debugString(const QString & msg, const QMessageLogContext &context = QMessageLogContext());
-    static QString infoString(const QString & msg, const QMessageLogContext &context = QMessageLogContext());
-    static QString warningString(const QString & msg, const QMessageLogContext &context = QMessageLogContext());
-    static QString criticalString(const QString & msg, const QMessageLogContext &context = QMessageLogContext());
-    static QString fatalString(const QString & msg, const QMessageLogContext &context = QMessageLogContext());
+    static QString debugString(const QString & msg, const QMessageLogContext &context = QMessageLogContext(), quint64 timestampNs = Timestamp::now());
+    static QString infoString(const QString & msg, const QMessageLogContext &context = QMessageLogContext(), quint64 timestampNs = Timestamp::now());
+    static QString warningString(const QString & msg, const QMessageLogContext &context = QMessageLogContext(), quint64 timestampNs = Timestamp::now());
+    static QString criticalString(const QString & msg, const QMessageLogContext &context = QMessageLogContext(), quint64 timestampNs = Timestamp::now());
+    static QString fatalString(const QString & msg, const QMessageLogContext &context = QMessageLogContext(), quint64 timestampNs = Timestamp::now());
 
     static QString hostNameString();
     static QString appNameString();
     static QString appRcCommandString();
     static QString argCommandString();
 
-    static bool parseDestination(const QString &destination, QHostAddress *address, quint16 *port);
+    static QStringList splitCommands(const QString &command);
+    static int utf8Size(const QString &msg);
 
 signals:
     void toggleStdErr();
     void toggleFile(const QString &filePath, int flushPeriodMsec);
-    void toggleUdp(const QHostAddress &address, quint16 port);
+    void toggleUdp(const QHostAddress &address, quint16 port, int multicastTtl, const QString &multicastInterface);
+    void toggleTcp(const QHostAddress &address, quint16 port);
+    void toggleSplitFile(const QString &basePath, int flushPeriodMsec);
     void toggleMute();
 
     void sendUdpMsg(const QString & msg, const QHostAddress &address, quint16 port);
+    void sendTcpMsg(const QString & msg);
 
 private slots:
     void switchToStdErr();
     void switchToFile(const QString &filePath, int flushPeriodMsec);
-    void switchToUdp(const QHostAddress &address, quint16 port);
+    void switchToUdp(const QHostAddress &address, quint16 port, int multicastTtl, const QString &multicastInterface);
+    void switchToTcp(const QHostAddress &address, quint16 port);
+    void switchToSplitFile(const QString &basePath, int flushPeriodMsec);
     void switchToMute();
 
     void flushEchoFile();
     void writeUdpMsg(const QString & msg, const QHostAddress &address, quint16 port);
+    void logScopeSummary();
 
 private slots:
     void onEchoModeChanged();
@@ -5,13 +5,14 @@
 #include <QThread>
 #include <QSettings>
 #include <QHostInfo>
-#include <QTime>
+#include <QNetworkInterface>
 #include <QDir>
 
 #include <stdio.h>
 #include <signal.h>
 
 #include "ansi-colors.h"
+#include "destination.h"
 
 // TODO: Decompose processCommand() function
 // TODO: Add active filters to status
@@ -31,54 +32,44 @@ void Logger::exec(const QString &command)
     instance().d_ptr->exec(command, QHostAddress::LocalHost);
 }
 
-void Logger::debug(const QString &msg, const QMessageLogContext &context)
+void Logger::debug(const QString &msg, const QMessageLogContext &context, quint64 timestampNs)
 {
     if (LoggerPrivate::destroyed) { return; }
-    if (!instance().d_ptr->passLevel(LoggerPrivate::Level::Debug)) { return; }
-    if (!instance().d_ptr->passFile(QString(context.file)))        { return; }
-    if (!instance().d_ptr->passFunc(QString(context.function)))    { return; }
+    if (!instance().d_ptr->passFilters(LoggerPrivate::Level::Debug, msg, context)) { return; }
 
-    instance().d_ptr->log(LoggerPrivate::debugString(msg, context));
+    instance().d_ptr->log(LoggerPrivate::debugString(msg, context, timestampNs), timestampNs);
 }
 
-void Logger::info(const QString &msg, const QMessageLogContext &context)
+void Logger::info(const QString &msg, const QMessageLogContext &context, quint64 timestampNs)
 {
     if (LoggerPrivate::destroyed) { return; }
-    if (!instance().d_ptr->passLevel(LoggerPrivate::Level::Info)) { return; }
-    if (!instance().d_ptr->passFile(QString(context.file)))       { return; }
-    if (!instance().d_ptr->passFunc(QString(context.function)))   { return; }
+    if (!instance().d_ptr->passFilters(LoggerPrivate::Level::Info, msg, context)) { return; }
 
-    instance().d_ptr->log(LoggerPrivate::infoString(msg, context));
+    instance().d_ptr->log(LoggerPrivate::infoString(msg, context, timestampNs), timestampNs);
 }
 
-void Logger::warning(const QString &msg, const QMessageLogContext &context)
+void Logger::warning(const QString &msg, const QMessageLogContext &context, quint64 timestampNs)
 {
     if (LoggerPrivate::destroyed) { return; }
-    if (!instance().d_ptr->passLevel(LoggerPrivate::Level::Warning)) { return; }
-    if (!instance().d_ptr->passFile(QString(context.file)))          { return; }
-    if (!instance().d_ptr->passFunc(QString(context.function)))      { return; }
+    if (!instance().d_ptr->passFilters(LoggerPrivate::Level::Warning, msg, context)) { return; }
 
-    instance().d_ptr->log(LoggerPrivate::warningString(msg, context));
+    instance().d_ptr->log(LoggerPrivate::warningString(msg, context, timestampNs), timestampNs);
 }
 
-void Logger::critical(const QString &msg, const QMessageLogContext &context)
+void Logger::critical(const QString &msg, const QMessageLogContext &context, quint64 timestampNs)
 {
     if (LoggerPrivate::destroyed) { return; }
-    if (!instance().d_ptr->passLevel(LoggerPrivate::Level::Critical)) { return; }
-    if (!instance().d_ptr->passFile(QString(context.file)))           { return; }
-    if (!instance().d_ptr->passFunc(QString(context.function)))       { return; }
+    if (!instance().d_ptr->passFilters(LoggerPrivate::Level::Critical, msg, context)) { return; }
 
-    instance().d_ptr->log(LoggerPrivate::criticalString(msg, context));
+    instance().d_ptr->log(LoggerPrivate::criticalString(msg, context, timestampNs), timestampNs);
 }
 
-void Logger::fatal(const QString &msg, const QMessageLogContext &context)
+void Logger::fatal(const QString &msg, const QMessageLogContext &context, quint64 timestampNs)
 {
     if (LoggerPrivate::destroyed) { return; }
-    if (!instance().d_ptr->passLevel(LoggerPrivate::Level::Fatal)) { return; }
-    if (!instance().d_ptr->passFile(QString(context.file)))        { return; }
-    if (!instance().d_ptr->passFunc(QString(context.function)))    { return; }
+    if (!instance().d_ptr->passFilters(LoggerPrivate::Level::Fatal, msg, context)) { return; }
 
-    instance().d_ptr->log(LoggerPrivate::fatalString(msg, context));
+    instance().d_ptr->log(LoggerPrivate::fatalString(msg, context, timestampNs), timestampNs);
 }
 
 Logger::Logger() :
@@ -104,19 +95,25 @@ LoggerPrivate::LoggerPrivate()
     originalSignalHandlers[SIGSEGV] = signal(SIGSEGV, LoggerPrivate::onAppTerminate);
 
     connect(&flushTimer, &QTimer::timeout, this, &LoggerPrivate::flushEchoFile);
+    connect(&scopeSummaryTimer, &QTimer::timeout, this, &LoggerPrivate::logScopeSummary);
 
     connect(this, &LoggerPrivate::toggleStdErr, this, &LoggerPrivate::onEchoModeChanged);
     connect(this, &LoggerPrivate::toggleFile, this, &LoggerPrivate::onEchoModeChanged);
     connect(this, &LoggerPrivate::toggleUdp, this, &LoggerPrivate::onEchoModeChanged);
+    connect(this, &LoggerPrivate::toggleTcp, this, &LoggerPrivate::onEchoModeChanged);
+    connect(this, &LoggerPrivate::toggleSplitFile, this, &LoggerPrivate::onEchoModeChanged);
     connect(this, &LoggerPrivate::toggleMute, this, &LoggerPrivate::onEchoModeChanged);
 
     connect(this, &LoggerPrivate::toggleStdErr, this, &LoggerPrivate::switchToStdErr);
     connect(this, &LoggerPrivate::toggleFile, this, &LoggerPrivate::switchToFile);
     connect(this, &LoggerPrivate::toggleUdp, this, &LoggerPrivate::switchToUdp);
+    connect(this, &LoggerPrivate::toggleTcp, this, &LoggerPrivate::switchToTcp);
+    connect(this, &LoggerPrivate::toggleSplitFile, this, &LoggerPrivate::switchToSplitFile);
     connect(this, &LoggerPrivate::toggleMute, this, &LoggerPrivate::switchToMute);
 
     qRegisterMetaType<QHostAddress>("QHostAddress");
     connect(this, &LoggerPrivate::sendUdpMsg, this, &LoggerPrivate::writeUdpMsg, Qt::QueuedConnection);
+    connect(this, &LoggerPrivate::sendTcpMsg, &tcpSink, &TcpSink::write, Qt::QueuedConnection);
 
     exec(appRcCommandString());
     exec(argCommandString());
@@ -131,9 +128,18 @@ void LoggerPrivate::configure()
     commandPort = uint16_t(settings.value("command-port", 6060u).toUInt());
     defaultDestPort = uint16_t(settings.value("default-dest-port", 6061u).toUInt());
     defaultFlushPeriodMsec = settings.value("default-flush-period", 5000).toInt();
+    defaultMulticastTtl = settings.value("default-multicast-ttl", 1).toInt();
+    const int scopeSummaryPeriodMsec = settings.value("scope-summary-period", 0).toInt();
+    if (scopeSummaryPeriodMsec > 0) {
+        scopeSummaryTimer.start(scopeSummaryPeriodMsec);
+    }
+    loadShedder.setBudget(settings.value("budget-messages", 0).toULongLong(),
+                          settings.value("budget-bytes", 0).toULongLong());
+    tcpSink.setSpill(QDir(settings.value("tcp-spill-dir", QDir::tempPath()).toString()).filePath(appNameString() + ".qtlogger-spill"),
+                     settings.value("tcp-spill-limit", 64 * 1024 * 1024).toLongLong());
 }
 
-void LoggerPrivate::log(const QString &msg)
+void LoggerPrivate::log(const QString &msg, quint64 timestampNs)
 {
     switch (echo)
     {
@@ -148,6 +154,12 @@ void LoggerPrivate::log(const QString &msg)
                              echoDestAddress,
                              echoDestPort );
             break;
+        case Echo::Tcp:
+            emit sendTcpMsg(msg);
+            break;
+        case Echo::SplitFile:
+            threadFileSink.write(msg, timestampNs);
+            break;
         default:
             break;
     }
@@ -155,7 +167,7 @@ void LoggerPrivate::log(const QString &msg)
 
 void LoggerPrivate::exec(const QString &command, const QHostAddress &sender)
 {
-    const auto &commands = command.split("|", QString::SkipEmptyParts);
+    const auto &commands = splitCommands(command);
     for (const auto &c : commands) {
         processCommand(c.split(" ", QString::SkipEmptyParts), sender);
     }
@@ -170,11 +182,53 @@ void LoggerPrivate::processCommand(const QStringList &command, const QHostAddres
     {
         QHostAddress address = (sender.isNull() ? QHostAddress::LocalHost : sender);
         quint16 port = defaultDestPort;
-        if (command.size() == 2 ) {
-            parseDestination(command.at(1), &address, &port);
+        if (command.size() == 2 && !parseDestination(command.at(1), &address, &port)) {
+            return;
         }
         emit sendUdpMsg(statusString(), address, port);
     }
+    else if (QString("top").startsWith(action))
+    {
+        QHostAddress address = (sender.isNull() ? QHostAddress::LocalHost : sender);
+        quint16 port = defaultDestPort;
+        const int count = ( command.size() < 2 ? 10 : qBound(1, command.at(1).toInt(), 100) );
+        if (command.size() == 3 && !parseDestination(command.at(2), &address, &port)) {
+            return;
+        }
+        emit sendUdpMsg(topString(count), address, port);
+    }
+    else if (QString("scopes").startsWith(action))
+    {
+        if (command.size() >= 2 && QString("summary").startsWith(command.at(1).simplified()))
+        {
+            const auto &periodMsec = ( command.size() < 3 ? 0 : command.at(2).toInt() );
+            if (periodMsec > 0) {
+                scopeSummaryTimer.start(periodMsec);
+            } else {
+                scopeSummaryTimer.stop();
+            }
+            return;
+        }
+
+        QHostAddress address = (sender.isNull() ? QHostAddress::LocalHost : sender);
+        quint16 port = defaultDestPort;
+        if (command.size() == 2 && !parseDestination(command.at(1), &address, &port)) {
+            return;
+        }
+        emit sendUdpMsg(scopesString(), address, port);
+    }
+    else if (QString("budget").startsWith(action))
+    {
+        if (command.size() < 2) { return; }
+        if (QString("off").startsWith(command.at(1).simplified())) {
+            loadShedder.setBudget(0, 0);
+            return;
+        }
+
+        const auto &messagesPerSec = command.at(1).toULongLong();
+        const auto &bytesPerSec = ( command.size() < 3 ? 0ull : command.at(2).toULongLong() );
+        loadShedder.setBudget(messagesPerSec, bytesPerSec);
+    }
     else if (QString("echo").startsWith(action))
     {
         if (command.size() < 2) { return; }
@@ -194,10 +248,27 @@ void LoggerPrivate::processCommand(const QStringList &command, const QHostAddres
         {
             QHostAddress address = (sender.isNull() ? QHostAddress::LocalHost : sender);
             quint16 port = defaultDestPort;
-            if (command.size() == 3 ) {
-                parseDestination(command.at(2), &address, &port);
+            if (command.size() >= 3 && !parseDestination(command.at(2), &address, &port)) {
+                return;
             }
-            emit toggleUdp(address, port);
+            const auto &multicastTtl = ( command.size() < 4 ? defaultMulticastTtl : command.at(3).toInt() );
+            const auto &multicastInterface = ( command.size() < 5 ? QString() : command.at(4) );
+            emit toggleUdp(address, port, multicastTtl, multicastInterface);
+        }
+        else if (QString("tcp").startsWith(echoMode))
+        {
+            QHostAddress address = (sender.isNull() ? QHostAddress::LocalHost : sender);
+            quint16 port = defaultDestPort;
+            if (command.size() == 3 && !parseDestination(command.at(2), &address, &port)) {
+                return;
+            }
+            emit toggleTcp(address, port);
+        }
+        else if (QString("split").startsWith(echoMode))
+        {
+            const auto &basePath = ( command.size() < 3 ? (appNameString() + ".log") : command.at(2) );
+            const auto &flushPeriodMsec = ( command.size() < 4 ? defaultFlushPeriodMsec : command.at(3).toInt() );
+            emit toggleSplitFile(basePath, flushPeriodMsec);
         }
         else if (QString("mute").startsWith(echoMode))
         {
@@ -229,6 +300,7 @@ void LoggerPrivate::processCommand(const QStringList &command, const QHostAddres
             levelFilter = quint32(Level::All);
             fileFilter.clear();
             funcFilter.clear();
+            messageFilter.clear();
         }
         else if (QString("level").startsWith(filterType))
         {
@@ -300,9 +372,41 @@ void LoggerPrivate::processCommand(const QStringList &command, const QHostAddres
                 }
             }
         }
+        else if (QString("message").startsWith(filterType))
+        {
+            if (operation == Clear) {
+                messageFilter.clear();
+                return;
+            }
+
+            const auto &pattern = command.mid(3).join(" ");
+            if (pattern.isEmpty()) {
+                return;
+            }
+
+            if (operation == Add) {
+                messageFilter.add(pattern);
+            } else {
+                messageFilter.remove(pattern);
+            }
+        }
     }
 }
 
+bool LoggerPrivate::passFilters(Level level, const QString &msg, const QMessageLogContext &context)
+{
+    bool passed = ( passLevel(level) &&
+                    passFile(QString(context.file)) &&
+                    passFunc(QString(context.function)) &&
+                    passMessage(msg) );
+    const int bytes = utf8Size(msg);
+    if (passed) {
+        passed = passBudget(level, bytes);
+    }
+    callSiteStats.hit(context, passed, bytes);
+    return passed;
+}
+
 bool LoggerPrivate::passDestination(const QString & destination) const
 {
     const auto &tupple = destination.split(":", QString::SkipEmptyParts);
@@ -361,17 +465,103 @@ bool LoggerPrivate::passFunc(const QString &func) const
     return false;
 }
 
+bool LoggerPrivate::passMessage(const QString &msg) const
+{
+    return messageFilter.pass(msg);
+}
+
+bool LoggerPrivate::passBudget(Level level, int bytes)
+{
+    LoadShedder::Severity severity = LoadShedder::Fatal;
+    switch (level) {
+        case Level::Debug:    severity = LoadShedder::Debug;    break;
+        case Level::Info:     severity = LoadShedder::Info;     break;
+        case Level::Warning:  severity = LoadShedder::Warning;  break;
+        case Level::Critical: severity = LoadShedder::Critical; break;
+        default: break;
+    }
+
+    QString notice;
+    const bool passed = loadShedder.admit(severity, bytes, &notice);
+    if (!notice.isEmpty()) {
+        log(warningString(notice));
+    }
+    return passed;
+}
+
 QString LoggerPrivate::statusString() const
 {
-    QString string = QString(GREEN "<%1" RESET GRAY "@" RESET CYAN "%2>  " RESET "%3").arg(QHostInfo::localHostName()).arg(appNameString());
+    QString string = QString(GREEN "<%1" RESET GRAY "@" RESET CYAN "%2>  " RESET "%3%4\n").arg(QHostInfo::localHostName()).arg(appNameString());
     switch (echo) {
-        case Echo::Mute:   return string.arg( QString("Muted\n") );
-        case Echo::StdErr: return string.arg( QString("Writing in stderr stream\n") );
-        case Echo::File:   return string.arg( QString("Writing in file %1\n").arg(echoFileStream.device() ? static_cast<QFile*>(echoFileStream.device())->fileName() : "") );
-        case Echo::Udp:    return string.arg( QString("Writing to %1:%2\n").arg(echoDestAddress.toString())
-                                                                           .arg(echoDestPort) );
+        case Echo::Mute:   string = string.arg( QString("Muted") ); break;
+        case Echo::StdErr: string = string.arg( QString("Writing in stderr stream") ); break;
+        case Echo::File:   string = string.arg( QString("Writing in file %1").arg(echoFileStream.device() ? static_cast<QFile*>(echoFileStream.device())->fileName() : "") ); break;
+        case Echo::Udp:    string = string.arg( QString("Writing to %1:%2%3").arg(echoDestAddress.toString())
+                                                                           .arg(echoDestPort)
+                                                                           .arg(echoDestAddress.isMulticast() ? QString(" multicast ttl %1 %2").arg(echoMulticastTtl)
+                                                                                                                                               .arg(echoMulticastInterface)
+                                                                                                              : QString()) ); break;
+        case Echo::Tcp:    string = string.arg( tcpSink.statusString() ); break;
+        case Echo::SplitFile: string = string.arg( threadFileSink.statusString() ); break;
+        default:           string = string.arg( QString("N/D") ); break;
+    }
+    return string.arg( loadShedder.isEnabled() ? QString(", ") + loadShedder.statusString() : QString() );
+}
+
+QString LoggerPrivate::topString(int count)
+{
+    QString string = QString(GREEN "<%1" RESET GRAY "@" RESET CYAN "%2>  " RESET "Top %3 call sites\n").arg(QHostInfo::localHostName())
+                                                                                                     .arg(appNameString())
+                                                                                                     .arg(count);
+    string += QString(GRAY "%1 %2 %3 %4  %5\n" RESET).arg("hits/s", 10)
+                                                     .arg("emitted", 12)
+                                                     .arg("filtered", 12)
+                                                     .arg("KiB/s", 9)
+                                                     .arg("call site");
+
+    for (const auto &site : callSiteStats.top(count))
+    {
+        // Release builds of Qt pass empty context unless QT_MESSAGELOGCONTEXT is defined
+        const QString &callSite = ( site.file ? QString("%1:%2 %3").arg(site.file).arg(site.line).arg(site.function ? site.function : "")
+                                              : QString("no context, define QT_MESSAGELOGCONTEXT") );
+        string += QString("%1 %2 %3 %4  %5\n").arg(site.hitRate, 10, 'f', 1)
+                                              .arg(site.emitted, 12)
+                                              .arg(site.filtered, 12)
+                                              .arg(site.byteRate / 1024., 9, 'f', 1)
+                                              .arg(callSite);
+    }
+
+    if (callSiteStats.overflow() > 0) {
+        string += QString(YELLOW "%1 hits on untracked call sites, table is crowded\n" RESET).arg(callSiteStats.overflow());
     }
-    return string.arg( QString("N/D\n") );
+    return string;
+}
+
+QString LoggerPrivate::scopesString() const
+{
+    QString string = QString(GREEN "<%1" RESET GRAY "@" RESET CYAN "%2>  " RESET "Scopes%3\n").arg(QHostInfo::localHostName())
+                                                                                           .arg(appNameString())
+                                                                                           .arg(scopeSummaryTimer.isActive() ? QString(", summary every %1 msec").arg(scopeSummaryTimer.interval())
+                                                                                                                             : QString());
+    string += QString(GRAY "%1 %2 %3 %4 %5 %6  %7\n" RESET).arg("count", 12)
+                                                           .arg("p50", 9)
+                                                           .arg("p90", 9)
+                                                           .arg("p99", 9)
+                                                           .arg("p99.9", 9)
+                                                           .arg("max", 9)
+                                                           .arg("scope");
+
+    for (const auto &stats : scope::collect(false))
+    {
+        string += QString("%1 %2 %3 %4 %5 %6  %7\n").arg(stats.count, 12)
+                                                    .arg(scope::durationString(stats.p50), 9)
+                                                    .arg(scope::durationString(stats.p90), 9)
+                                                    .arg(scope::durationString(stats.p99), 9)
+                                                    .arg(scope::durationString(stats.p999), 9)
+                                                    .arg(scope::durationString(stats.max), 9)
+                                                    .arg(stats.name);
+    }
+    return string;
 }
 
 void LoggerPrivate::resetSignals()
@@ -382,41 +572,41 @@ void LoggerPrivate::resetSignals()
     signal(SIGSEGV, originalSignalHandlers[SIGSEGV]);
 }
 
-QString LoggerPrivate::debugString(const QString &msg, const QMessageLogContext & context)
+QString LoggerPrivate::debugString(const QString &msg, const QMessageLogContext & context, quint64 timestampNs)
 {
     Q_UNUSED(context)
-    return QString(GRAY "[%1] DEBG <%2> %3" RESET).arg(QTime::currentTime().toString("hh:mm:ss.zzz").toLocal8Bit().constData())
+    return QString(GRAY "[%1] DEBG <%2> %3" RESET).arg(Timestamp::timeString(timestampNs))
                                                   .arg(LoggerPrivate::appNameString())
                                                   .arg(msg);
 }
 
-QString LoggerPrivate::infoString(const QString &msg, const QMessageLogContext & context)
+QString LoggerPrivate::infoString(const QString &msg, const QMessageLogContext & context, quint64 timestampNs)
 {
     Q_UNUSED(context)
-    return QString(GRAY "[%1] " RESET BLUE "INFO <%2> " RESET "%3").arg(QTime::currentTime().toString("hh:mm:ss.zzz").toLocal8Bit().constData())
+    return QString(GRAY "[%1] " RESET BLUE "INFO <%2> " RESET "%3").arg(Timestamp::timeString(timestampNs))
                                                                    .arg(LoggerPrivate::appNameString())
                                                                    .arg(msg);
 }
 
-QString LoggerPrivate::warningString(const QString &msg, const QMessageLogContext & context)
+QString LoggerPrivate::warningString(const QString &msg, const QMessageLogContext & context, quint64 timestampNs)
 {
     Q_UNUSED(context)
-    return QString("[%1] " YELLOW "WARN <%2> " RESET "%3").arg(QTime::currentTime().toString("hh:mm:ss.zzz").toLocal8Bit().constData())
+    return QString("[%1] " YELLOW "WARN <%2> " RESET "%3").arg(Timestamp::timeString(timestampNs))
                                                           .arg(LoggerPrivate::appNameString())
                                                           .arg(msg);
 }
 
-QString LoggerPrivate::criticalString(const QString &msg, const QMessageLogContext & context)
+QString LoggerPrivate::criticalString(const QString &msg, const QMessageLogContext & context, quint64 timestampNs)
 {
     Q_UNUSED(context)
-    return QString("[%1] " RED "CRIT <%2> " RESET "%3").arg(QTime::currentTime().toString("hh:mm:ss.zzz").toLocal8Bit().constData())
+    return QString("[%1] " RED "CRIT <%2> " RESET "%3").arg(Timestamp::timeString(timestampNs))
                                                        .arg(LoggerPrivate::appNameString())
                                                        .arg(msg);
 }
 
-QString LoggerPrivate::fatalString(const QString &msg, const QMessageLogContext & context)
+QString LoggerPrivate::fatalString(const QString &msg, const QMessageLogContext & context, quint64 timestampNs)
 {
-    return QString(RED "[%1] FATL <%2> terminated at %3:%4 " RESET "%5").arg(QTime::currentTime().toString("hh:mm:ss.zzz").toLocal8Bit().constData())
+    return QString(RED "[%1] FATL <%2> terminated at %3:%4 " RESET "%5").arg(Timestamp::timeString(timestampNs))
                                                                         .arg(LoggerPrivate::appNameString())
                                                                         .arg(context.file)
                                                                         .arg(context.line)
@@ -476,29 +666,44 @@ QString LoggerPrivate::argCommandString()
     return string;
 }
 
-bool LoggerPrivate::parseDestination(const QString &destination, QHostAddress * address, quint16 * port)
+int LoggerPrivate::utf8Size(const QString &msg)
 {
-    const auto &tupple = destination.split(":", QString::SkipEmptyParts);
-    if (tupple.size() == 2)
+    int size = 0;
+    for (const QChar c : msg)
     {
-        if (address) { address->setAddress(tupple.first()); }
-        if (port) { *port = tupple.last().toUShort(); }
-        return true;
+        const ushort unicode = c.unicode();
+        size += ( unicode < 0x80 ? 1
+                : unicode < 0x800 ? 2
+                : c.isSurrogate() ? 2
+                : 3 );
     }
-    else if (tupple.size() == 1)
+    return size;
+}
+
+QStringList LoggerPrivate::splitCommands(const QString &command)
+{
+    QStringList commands;
+    QString current;
+    for (int i = 0, size = command.size(); i < size; ++i)
     {
-        QRegExp rx("\\d+");
-        if (rx.indexIn(tupple.first()) != -1)
+        const QChar c = command.at(i);
+        if (c == '\\' && i + 1 < size && command.at(i + 1) == '|')
         {
-            if (port) { *port = tupple.first().toUShort(); }
+            current.append('|');
+            ++i;
+        }
+        else if (c == '|')
+        {
+            if (!current.isEmpty()) { commands.append(current); }
+            current.clear();
         }
         else
         {
-            if (address) { address->setAddress(tupple.first()); }
+            current.append(c);
         }
-        return true;
     }
-    return false;
+    if (!current.isEmpty()) { commands.append(current); }
+    return commands;
 }
 
 void LoggerPrivate::switchToStdErr()
@@ -521,11 +726,47 @@ void LoggerPrivate::switchToFile(const QString &filePath, int flushPeriodMsec)
     flushTimer.start(flushPeriodMsec);
 }
 
-void LoggerPrivate::switchToUdp(const QHostAddress &address, quint16 port)
+void LoggerPrivate::switchToUdp(const QHostAddress &address, quint16 port, int multicastTtl, const QString &multicastInterface)
 {
     echo = Echo::Udp;
     echoDestAddress = address;
     echoDestPort = port;
+    echoMulticastTtl = multicastTtl;
+    echoMulticastInterface = multicastInterface;
+
+    // Unbound socket binds on first datagram to any address of the right family
+    writeSocket.close();
+    if (!address.isMulticast()) {
+        return;
+    }
+
+    writeSocket.bind(QHostAddress(address.protocol() == QAbstractSocket::IPv6Protocol ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4), 0);
+    writeSocket.setSocketOption(QAbstractSocket::MulticastTtlOption, multicastTtl);
+    writeSocket.setSocketOption(QAbstractSocket::MulticastLoopbackOption, 1);
+
+    if (!multicastInterface.isEmpty())
+    {
+        const auto &networkInterface = QNetworkInterface::interfaceFromName(multicastInterface);
+        if (!networkInterface.isValid())
+        {
+            qWarning() << Q_FUNC_INFO << "Unknown multicast interface" << multicastInterface;
+            return;
+        }
+        writeSocket.setMulticastInterface(networkInterface);
+    }
+}
+
+void LoggerPrivate::switchToTcp(const QHostAddress &address, quint16 port)
+{
+    echo = Echo::Tcp;
+    tcpSink.start(address, port);
+}
+
+void LoggerPrivate::switchToSplitFile(const QString &basePath, int flushPeriodMsec)
+{
+    echo = Echo::SplitFile;
+    threadFileSink.start(basePath, flushPeriodMsec);
+    flushTimer.start(flushPeriodMsec);
 }
 
 void LoggerPrivate::switchToMute()
@@ -536,6 +777,7 @@ void LoggerPrivate::switchToMute()
 void LoggerPrivate::flushEchoFile()
 {
     echoFileStream.flush();
+    threadFileSink.flush();
 }
 
 void LoggerPrivate::writeUdpMsg(const QString &msg, const QHostAddress &address, quint16 port)
@@ -543,12 +785,28 @@ void LoggerPrivate::writeUdpMsg(const QString &msg, const QHostAddress &address,
     writeSocket.writeDatagram(msg.toLocal8Bit(), address, port);
 }
 
+void LoggerPrivate::logScopeSummary()
+{
+    for (const auto &stats : scope::collect(true))
+    {
+        log(infoString(QString("Scope %1 count %2 p50 %3 p90 %4 p99 %5 p99.9 %6 max %7").arg(stats.name)
+                                                                                        .arg(stats.count)
+                                                                                        .arg(scope::durationString(stats.p50))
+                                                                                        .arg(scope::durationString(stats.p90))
+                                                                                        .arg(scope::durationString(stats.p99))
+                                                                                        .arg(scope::durationString(stats.p999))
+                                                                                        .arg(scope::durationString(stats.max))));
+    }
+}
+
 void LoggerPrivate::onEchoModeChanged()
 {
     flushTimer.stop();
     if (echoFileStream.device()) {
         echoFileStream.device()->close();
     }
+    tcpSink.stop();
+    threadFileSink.stop();
 }
 
 void LoggerPrivate::onCommandReceived()
@@ -581,10 +839,14 @@ void LoggerPrivate::onAppTerminate(int signum)
             break;
     }
 
-    if (Logger::instance().d_ptr->echo == Echo::File) {
+    if (Logger::instance().d_ptr->echo == Echo::File || Logger::instance().d_ptr->echo == Echo::SplitFile) {
         Logger::instance().d_ptr->flushEchoFile();
     }
 
+    if (Logger::instance().d_ptr->echo == Echo::Tcp) {
+        Logger::instance().d_ptr->tcpSink.spillPending();
+    }
+
     Logger::instance().d_ptr->resetSignals();
     raise(signum);
 }
@@ -3,6 +3,8 @@
 
 #include <QScopedPointer>
 
+#include "timestamp.h"
+
 namespace qtlogger {
 
 class LoggerPrivate;
@@ -12,11 +14,11 @@ public:
 public:
     static void exec(const QString &command);
 public:
-    static void debug(const QString &msg, const QMessageLogContext &context);
-    static void info(const QString &msg, const QMessageLogContext &context);
-    static void warning(const QString &msg, const QMessageLogContext &context);
-    static void critical(const QString &msg, const QMessageLogContext &context);
-    static void fatal(const QString &msg, const QMessageLogContext &context);
+    static void debug(const QString &msg, const QMessageLogContext &context, quint64 timestampNs = Timestamp::now());
+    static void info(const QString &msg, const QMessageLogContext &context, quint64 timestampNs = Timestamp::now());
+    static void warning(const QString &msg, const QMessageLogContext &context, quint64 timestampNs = Timestamp::now());
+    static void critical(const QString &msg, const QMessageLogContext &context, quint64 timestampNs = Timestamp::now());
+    static void fatal(const QString &msg, const QMessageLogContext &context, quint64 timestampNs = Timestamp::now());
 
 private:
     static Logger & instance();
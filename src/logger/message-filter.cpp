@@ -0,0 +1,326 @@
+#include "message-filter.h"
+
+#include <QRegExp>
+#include <QVarLengthArray>
+
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define QTLOGGER_X86_SIMD
+#endif
+
+namespace qtlogger {
+
+namespace {
+
+bool isHexDigit(QChar c)
+{
+    const ushort u = c.unicode();
+    return ((u >= '0' && u <= '9') || (u >= 'a' && u <= 'f') || (u >= 'A' && u <= 'F'));
+}
+
+int scalarCandidate(const ushort *data, int size, int from, const MessageFilter::PairSet &pairs)
+{
+    for (int i = from; i + 1 < size; ++i)
+    {
+        for (int k = 0; k < pairs.count; ++k)
+        {
+            if (data[i] == pairs.first[k] && data[i + 1] == pairs.second[k]) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+#ifdef QTLOGGER_X86_SIMD
+int sse2Candidate(const ushort *data, int size, int from, const MessageFilter::PairSet &pairs)
+{
+    __m128i first[MessageFilter::MaxPairs];
+    __m128i second[MessageFilter::MaxPairs];
+    for (int k = 0; k < pairs.count; ++k)
+    {
+        first[k] = _mm_set1_epi16(short(pairs.first[k]));
+        second[k] = _mm_set1_epi16(short(pairs.second[k]));
+    }
+
+    int i = from;
+    for (; i + 9 <= size; i += 8)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1));
+        __m128i hits = _mm_setzero_si128();
+        for (int k = 0; k < pairs.count; ++k) {
+            hits = _mm_or_si128(hits, _mm_and_si128(_mm_cmpeq_epi16(a, first[k]), _mm_cmpeq_epi16(b, second[k])));
+        }
+
+        const unsigned mask = unsigned(_mm_movemask_epi8(hits));
+        if (mask) {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+    return scalarCandidate(data, size, i, pairs);
+}
+
+__attribute__((target("avx2")))
+int avx2Candidate(const ushort *data, int size, int from, const MessageFilter::PairSet &pairs)
+{
+    __m256i first[MessageFilter::MaxPairs];
+    __m256i second[MessageFilter::MaxPairs];
+    for (int k = 0; k < pairs.count; ++k)
+    {
+        first[k] = _mm256_set1_epi16(short(pairs.first[k]));
+        second[k] = _mm256_set1_epi16(short(pairs.second[k]));
+    }
+
+    int i = from;
+    for (; i + 17 <= size; i += 16)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 1));
+        __m256i hits = _mm256_setzero_si256();
+        for (int k = 0; k < pairs.count; ++k) {
+            hits = _mm256_or_si256(hits, _mm256_and_si256(_mm256_cmpeq_epi16(a, first[k]), _mm256_cmpeq_epi16(b, second[k])));
+        }
+
+        const unsigned mask = unsigned(_mm256_movemask_epi8(hits));
+        if (mask) {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+    return scalarCandidate(data, size, i, pairs);
+}
+#endif
+
+}
+
+void MessageFilter::add(const QString &pattern)
+{
+    Entry entry;
+    entry.pattern = pattern;
+    entry.literal = literal(pattern);
+    entries.append(entry);
+    rebuild();
+}
+
+void MessageFilter::remove(const QString &pattern)
+{
+    QRegExp rx(pattern);
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (rx.indexIn(it->pattern) != -1) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    rebuild();
+}
+
+void MessageFilter::clear()
+{
+    entries.clear();
+    rebuild();
+}
+
+bool MessageFilter::isEmpty() const
+{
+    return entries.isEmpty();
+}
+
+QStringList MessageFilter::patterns() const
+{
+    QStringList list;
+    for (const auto &entry : entries) {
+        list.append(entry.pattern);
+    }
+    return list;
+}
+
+bool MessageFilter::pass(const QString &msg) const
+{
+    if (entries.isEmpty()) {
+        return true;
+    }
+
+    for (int entry : unfiltered)
+    {
+        if (match(entry, msg)) {
+            return true;
+        }
+    }
+
+    QVarLengthArray<bool, 64> checked(entries.size());
+    memset(checked.data(), 0, size_t(checked.size()) * sizeof(bool));
+
+    const ushort *data = msg.utf16();
+    const int size = msg.size();
+    for (int pos = nextCandidate(data, size, 0, pairs); pos != -1; pos = nextCandidate(data, size, pos + 1, pairs))
+    {
+        for (int k = 0; k < pairs.count; ++k)
+        {
+            if (data[pos] != pairs.first[k] || data[pos + 1] != pairs.second[k]) {
+                continue;
+            }
+
+            for (int entry : pairEntries.at(k))
+            {
+                const QString &literal = entries.at(entry).literal;
+                if (checked[entry] || pos + literal.size() > size || memcmp(data + pos, literal.utf16(), size_t(literal.size()) * sizeof(ushort)) != 0) {
+                    continue;
+                }
+
+                checked[entry] = true;
+                if (match(entry, msg)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+QString MessageFilter::literal(const QString &pattern)
+{
+    if (pattern.contains('|')) {
+        return QString();
+    }
+
+    QString best;
+    QString run;
+    const auto commit = [&best, &run]() -> void
+    {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    int depth = 0;
+    for (int i = 0, size = pattern.size(); i < size; ++i)
+    {
+        QChar c = pattern.at(i);
+        if (c == '\\')
+        {
+            if (++i == size) {
+                commit();
+                continue;
+            }
+            if (pattern.at(i).isLetterOrNumber())
+            {
+                // Operands of \x41, \0101, \1, \p{L} or \cA are no literal text either
+                commit();
+                const QChar escape = pattern.at(i);
+                if (escape == 'c') {
+                    ++i;
+                } else if (i + 1 < size && pattern.at(i + 1) == '{') {
+                    while (i < size && pattern.at(i) != '}') { ++i; }
+                } else if (escape == 'x' || escape == 'u') {
+                    while (i + 1 < size && isHexDigit(pattern.at(i + 1))) { ++i; }
+                } else if (escape.isDigit()) {
+                    while (i + 1 < size && pattern.at(i + 1).isDigit()) { ++i; }
+                }
+                continue;
+            }
+            c = pattern.at(i);
+        }
+        else if (c == '[')
+        {
+            commit();
+            if (++i < size && pattern.at(i) == '^') { ++i; }
+            if (i < size && pattern.at(i) == ']') { ++i; }
+            for (; i < size && pattern.at(i) != ']'; ++i) {
+                if (pattern.at(i) == '\\') { ++i; }
+            }
+            continue;
+        }
+        else if (c == '{')
+        {
+            commit();
+            while (i < size && pattern.at(i) != '}') { ++i; }
+            continue;
+        }
+        else if (c == '(' || c == ')')
+        {
+            commit();
+            depth = qMax(0, depth + (c == '(' ? 1 : -1));
+            continue;
+        }
+        else if (c == '.' || c == '^' || c == '$' || c == '*' || c == '?' || c == '+')
+        {
+            commit();
+            continue;
+        }
+
+        const QChar following = (i + 1 < size ? pattern.at(i + 1) : QChar());
+        if (depth > 0 || following == '*' || following == '?' || following == '{')
+        {
+            commit();
+            continue;
+        }
+
+        run.append(c);
+        if (following == '+') {
+            commit();
+        }
+    }
+    commit();
+
+    return (best.size() >= 2 ? best : QString());
+}
+
+int MessageFilter::nextCandidate(const ushort *data, int size, int from, const PairSet &pairs)
+{
+#ifdef QTLOGGER_X86_SIMD
+    static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return (avx2 ? avx2Candidate(data, size, from, pairs)
+                 : sse2Candidate(data, size, from, pairs));
+#else
+    return scalarCandidate(data, size, from, pairs);
+#endif
+}
+
+void MessageFilter::rebuild()
+{
+    unfiltered.clear();
+    pairEntries.clear();
+    pairs.count = 0;
+
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        const QString &literal = entries.at(i).literal;
+        if (literal.size() < 2) {
+            unfiltered.append(i);
+            continue;
+        }
+
+        const ushort first = literal.at(0).unicode();
+        const ushort second = literal.at(1).unicode();
+        int k = 0;
+        while (k < pairs.count && (pairs.first[k] != first || pairs.second[k] != second)) {
+            ++k;
+        }
+
+        if (k == pairs.count)
+        {
+            if (pairs.count == MaxPairs) {
+                unfiltered.append(i);
+                continue;
+            }
+            pairs.first[k] = first;
+            pairs.second[k] = second;
+            ++pairs.count;
+            pairEntries.append(QVector<int>());
+        }
+        pairEntries[k].append(i);
+    }
+}
+
+bool MessageFilter::match(int entry, const QString &msg) const
+{
+    QRegExp rx(entries.at(entry).pattern);
+    return (rx.indexIn(msg) != -1);
+}
+
+}
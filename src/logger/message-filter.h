@@ -0,0 +1,50 @@
+#ifndef QTLOGGER_MESSAGEFILTER_H
+#define QTLOGGER_MESSAGEFILTER_H
+
+#include <QStringList>
+#include <QVector>
+
+namespace qtlogger {
+
+class MessageFilter {
+public:
+    enum { MaxPairs = 16 };
+
+    struct PairSet {
+        int count = 0;
+        ushort first[MaxPairs];
+        ushort second[MaxPairs];
+    };
+
+public:
+    void add(const QString &pattern);
+    void remove(const QString &pattern);
+    void clear();
+
+    bool isEmpty() const;
+    QStringList patterns() const;
+
+    bool pass(const QString &msg) const;
+
+    static QString literal(const QString &pattern);
+    static int nextCandidate(const ushort *data, int size, int from, const PairSet &pairs);
+
+private:
+    void rebuild();
+    bool match(int entry, const QString &msg) const;
+
+private:
+    struct Entry {
+        QString pattern;
+        QString literal;
+    };
+
+    QVector<Entry> entries;
+    QVector<int> unfiltered;
+    QVector<QVector<int>> pairEntries;
+    PairSet pairs;
+};
+
+}
+
+#endif // QTLOGGER_MESSAGEFILTER_H
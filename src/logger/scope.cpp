@@ -0,0 +1,208 @@
+#include "scope.h"
+
+#include <mutex>
+#include <vector>
+
+#include <string.h>
+
+namespace qtlogger {
+namespace scope {
+
+namespace {
+
+typedef std::vector<quint64> Totals;
+
+struct Scope {
+    const char *name;
+    Totals retired;
+    Totals previous;
+    quint64 retiredMax = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<Scope> scopes;
+    std::vector<Histograms *> threads;
+
+    static Registry & instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+};
+
+struct Holder {
+    Histograms *histograms = nullptr;
+    ~Holder()
+    {
+        if (histograms) {
+            histograms->abandoned.store(true, std::memory_order_release);
+        }
+    }
+};
+
+quint64 percentile(const Totals &totals, quint64 count, double fraction)
+{
+    const quint64 rank = qMax(quint64(1), quint64(fraction * count + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < Histogram::Buckets; ++i)
+    {
+        seen += totals[size_t(i)];
+        if (seen >= rank) {
+            return Histogram::value(i);
+        }
+    }
+    return 0;
+}
+
+void accumulate(const Histogram &histogram, Totals *totals, quint64 *max)
+{
+    for (int i = 0; i < Histogram::Buckets; ++i) {
+        (*totals)[size_t(i)] += histogram.counts[i].load(std::memory_order_relaxed);
+    }
+    *max = qMax(*max, histogram.max.load(std::memory_order_relaxed));
+}
+
+}
+
+quint64 Histogram::value(int bucket)
+{
+    if (bucket < 2 * SubBuckets) {
+        return quint64(bucket);
+    }
+
+    const int shift = bucket / SubBuckets - 1;
+    const quint64 low = quint64(bucket % SubBuckets + SubBuckets) << shift;
+    return low + (quint64(1) << shift) / 2;
+}
+
+Site::Site(const char *name) :
+    id(-1)
+{
+    Registry &registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (size_t i = 0; i < registry.scopes.size(); ++i)
+    {
+        if (strcmp(registry.scopes[i].name, name) == 0) {
+            id = int(i);
+            return;
+        }
+    }
+
+    if (registry.scopes.size() == size_t(MaxScopes)) {
+        return;
+    }
+
+    Scope scope;
+    scope.name = name;
+    scope.retired.assign(size_t(Histogram::Buckets), 0);
+    scope.previous.assign(size_t(Histogram::Buckets), 0);
+    registry.scopes.push_back(scope);
+    id = int(registry.scopes.size()) - 1;
+}
+
+Histograms * attach()
+{
+    static thread_local Holder holder;
+    holder.histograms = new Histograms();
+
+    Registry &registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(holder.histograms);
+    return holder.histograms;
+}
+
+Histogram * create(Histograms *histograms, int id)
+{
+    Histogram *histogram = new Histogram();
+    histograms->scopes[id].store(histogram, std::memory_order_release);
+    return histogram;
+}
+
+QVector<Stats> collect(bool interval)
+{
+    Registry &registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::vector<Totals> totals(registry.scopes.size(), Totals(size_t(Histogram::Buckets), 0));
+    std::vector<quint64> maxima(registry.scopes.size(), 0);
+    for (auto it = registry.threads.begin(); it != registry.threads.end();)
+    {
+        Histograms *histograms = *it;
+        const bool abandoned = histograms->abandoned.load(std::memory_order_acquire);
+        for (size_t id = 0; id < registry.scopes.size(); ++id)
+        {
+            const Histogram *histogram = histograms->scopes[id].load(std::memory_order_acquire);
+            if (!histogram) {
+                continue;
+            }
+
+            // Finished threads are folded into the scope and released
+            Scope &scope = registry.scopes[id];
+            accumulate(*histogram, (abandoned ? &scope.retired : &totals[id]), (abandoned ? &scope.retiredMax : &maxima[id]));
+            if (abandoned) {
+                delete histogram;
+            }
+        }
+
+        if (abandoned) {
+            delete histograms;
+            it = registry.threads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QVector<Stats> stats;
+    for (size_t id = 0; id < registry.scopes.size(); ++id)
+    {
+        Scope &scope = registry.scopes[id];
+        Totals &current = totals[id];
+        quint64 count = 0;
+        int highest = 0;
+        for (int i = 0; i < Histogram::Buckets; ++i)
+        {
+            current[size_t(i)] += scope.retired[size_t(i)];
+            if (interval)
+            {
+                const quint64 total = current[size_t(i)];
+                current[size_t(i)] -= scope.previous[size_t(i)];
+                scope.previous[size_t(i)] = total;
+            }
+            count += current[size_t(i)];
+            highest = (current[size_t(i)] ? i : highest);
+        }
+
+        if (count == 0) {
+            continue;
+        }
+
+        Stats stat;
+        stat.name = QString::fromUtf8(scope.name);
+        stat.count = count;
+        stat.p50 = percentile(current, count, 0.5);
+        stat.p90 = percentile(current, count, 0.9);
+        stat.p99 = percentile(current, count, 0.99);
+        stat.p999 = percentile(current, count, 0.999);
+        stat.max = (interval ? Histogram::value(highest) : qMax(maxima[id], scope.retiredMax));
+        stats.append(stat);
+    }
+    return stats;
+}
+
+QString durationString(quint64 ns)
+{
+    if (ns < 1000ull) {
+        return QString("%1ns").arg(ns);
+    }
+    if (ns < 1000000ull) {
+        return QString("%1us").arg(ns / 1e3, 0, 'f', 1);
+    }
+    if (ns < 1000000000ull) {
+        return QString("%1ms").arg(ns / 1e6, 0, 'f', 2);
+    }
+    return QString("%1s").arg(ns / 1e9, 0, 'f', 2);
+}
+
+}
+}
@@ -0,0 +1,127 @@
+#ifndef QTLOGGER_SCOPE_H
+#define QTLOGGER_SCOPE_H
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+#include "timestamp.h"
+
+#define QTLOG_SCOPE(name) QTLOG_SCOPE_AT(name, __LINE__)
+#define QTLOG_SCOPE_AT(name, line) QTLOG_SCOPE_IMPL(name, line)
+#define QTLOG_SCOPE_IMPL(name, line) \
+    static const qtlogger::scope::Site qtlogScopeSite##line(name); \
+    const qtlogger::scope::Guard qtlogScopeGuard##line(qtlogScopeSite##line)
+
+namespace qtlogger {
+namespace scope {
+
+enum {
+    MaxScopes = 256
+};
+
+// Log-linear buckets: exact below 64 ns, then 32 sub-buckets per power of two
+// (about 3% relative error) up to 2^41 ns
+struct Histogram {
+    enum {
+        SubBucketBits = 5,
+        SubBuckets =    1 << SubBucketBits,
+        MaxExponent =   40,
+        Buckets =       (MaxExponent - SubBucketBits + 2) * SubBuckets
+    };
+
+    static int bucket(quint64 ns)
+    {
+        if (ns < quint64(SubBuckets)) {
+            return int(ns);
+        }
+
+        ns = qMin(ns, (quint64(2) << MaxExponent) - 1);
+        const int shift = (63 - __builtin_clzll(ns)) - SubBucketBits;
+        return (shift + 1) * SubBuckets + int((ns >> shift) - SubBuckets);
+    }
+
+    static quint64 value(int bucket);
+
+    // Only the owning thread writes, readers may see a slightly stale view
+    void add(quint64 ns)
+    {
+        std::atomic<quint64> &count = counts[bucket(ns)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (ns > max.load(std::memory_order_relaxed)) {
+            max.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<quint64> counts[Buckets];
+    std::atomic<quint64> max;
+};
+
+struct Histograms {
+    std::atomic<Histogram *> scopes[MaxScopes];
+    std::atomic<bool> abandoned;
+};
+
+struct Stats {
+    QString name;
+    quint64 count;
+    quint64 p50;
+    quint64 p90;
+    quint64 p99;
+    quint64 p999;
+    quint64 max;
+};
+
+class Site {
+public:
+    explicit Site(const char *name);
+public:
+    int id;
+};
+
+Histograms * attach();
+Histogram * create(Histograms *histograms, int id);
+
+inline void record(int id, quint64 ns)
+{
+    static thread_local Histograms *histograms = nullptr;
+    if (Q_UNLIKELY(!histograms)) {
+        histograms = attach();
+    }
+
+    Histogram *histogram = histograms->scopes[id].load(std::memory_order_relaxed);
+    if (Q_UNLIKELY(!histogram)) {
+        histogram = create(histograms, id);
+    }
+    histogram->add(ns);
+}
+
+class Guard {
+public:
+    explicit Guard(const Site &site) :
+        id(site.id),
+        startTicks(Timestamp::ticks())
+    {}
+
+    ~Guard()
+    {
+        if (id >= 0) {
+            record(id, Timestamp::ticksToNs(Timestamp::ticks() - startTicks));
+        }
+    }
+
+private:
+    const int id;
+    const quint64 startTicks;
+};
+
+// Percentiles over all threads since start, or since the previous interval call
+QVector<Stats> collect(bool interval);
+
+QString durationString(quint64 ns);
+
+}
+}
+
+#endif // QTLOGGER_SCOPE_H
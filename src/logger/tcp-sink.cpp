@@ -0,0 +1,323 @@
+#include "tcp-sink.h"
+
+#include <QCoreApplication>
+#include <QtEndian>
+
+namespace qtlogger {
+
+namespace {
+
+int frameMessages(const QByteArray &frames)
+{
+    int messages = 0;
+    for (int offset = 0; frames.size() - offset >= 4;)
+    {
+        const auto length = int(qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(frames.constData() + offset)));
+        messages += frames.mid(offset + 4, length).count('\n');
+        offset += 4 + length;
+    }
+    return messages;
+}
+
+}
+
+TcpSink::TcpSink(QObject *parent) :
+    QObject(parent)
+{
+    batchTimer.setSingleShot(true);
+    reconnectTimer.setSingleShot(true);
+
+    connect(&batchTimer, &QTimer::timeout, this, &TcpSink::flushBatch);
+    connect(&reconnectTimer, &QTimer::timeout, this, &TcpSink::reconnect);
+    connect(&socket, &QTcpSocket::stateChanged, this, &TcpSink::onStateChanged);
+    connect(&socket, &QTcpSocket::bytesWritten, this, &TcpSink::onBytesWritten);
+}
+
+TcpSink::~TcpSink()
+{
+    disconnect(&socket, nullptr, this, nullptr);
+    spillPending();
+    compactSpill();
+}
+
+void TcpSink::setSpill(const QString &filePath, qint64 limitBytes)
+{
+    spillFile.close();
+    spillLock.reset();
+    spillPath = filePath;
+    spillLimit = limitBytes;
+    spillReadOffset = 0;
+}
+
+void TcpSink::start(const QHostAddress &address, quint16 port)
+{
+    active = false;
+    reconnectTimer.stop();
+    socket.abort();
+
+    active = true;
+    destAddress = address;
+    destPort = port;
+    reconnectMsec = MinReconnectMsec;
+    openSpill();
+    reconnect();
+}
+
+void TcpSink::stop()
+{
+    if (!active) {
+        return;
+    }
+
+    flushBatch();
+    active = false;
+    reconnectTimer.stop();
+    if (socket.state() == QAbstractSocket::ConnectedState) {
+        socket.disconnectFromHost();
+    } else {
+        socket.abort();
+    }
+    compactSpill();
+}
+
+void TcpSink::write(const QString &msg)
+{
+    if (!active) {
+        return;
+    }
+
+    batch.append(msg.toLocal8Bit());
+    batch.append('\n');
+    ++batchMessages;
+
+    if (batch.size() >= MaxBatchBytes) {
+        flushBatch();
+    } else if (!batchTimer.isActive()) {
+        batchTimer.start(BatchPeriodMsec);
+    }
+}
+
+void TcpSink::spillPending()
+{
+    spillInFlight();
+    batchTimer.stop();
+    int messages = 0;
+    const QByteArray &frame = takeFrame(&messages);
+    if (!frame.isEmpty()) {
+        spill(frame, messages);
+    }
+}
+
+QString TcpSink::statusString() const
+{
+    return QString("Streaming to %1:%2 (%3), %4 bytes spilled, %5 messages dropped")
+            .arg(destAddress.toString())
+            .arg(destPort)
+            .arg(socket.state() == QAbstractSocket::ConnectedState ? "connected" : "reconnecting")
+            .arg(spilledBytes())
+            .arg(droppedMessages);
+}
+
+void TcpSink::flushBatch()
+{
+    batchTimer.stop();
+    int messages = 0;
+    const QByteArray &frame = takeFrame(&messages);
+    if (frame.isEmpty()) {
+        return;
+    }
+
+    if (socket.state() == QAbstractSocket::ConnectedState && spilledBytes() == 0 && socket.bytesToWrite() < HighWaterBytes) {
+        send(frame);
+    } else {
+        spill(frame, messages);
+    }
+}
+
+void TcpSink::reconnect()
+{
+    if (active) {
+        socket.connectToHost(destAddress, destPort);
+    }
+}
+
+void TcpSink::replaySpill()
+{
+    while (socket.state() == QAbstractSocket::ConnectedState && socket.bytesToWrite() < HighWaterBytes && spilledBytes() > 0)
+    {
+        spillFile.seek(spillReadOffset);
+        const QByteArray &chunk = spillFile.read(ReplayChunkBytes);
+
+        int offset = 0;
+        while (chunk.size() - offset >= 4)
+        {
+            const auto length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(chunk.constData() + offset));
+            if (quint32(chunk.size() - offset - 4) < length) {
+                break;
+            }
+            offset += 4 + int(length);
+        }
+
+        if (offset == 0)
+        {
+            const auto length = (chunk.size() >= 4 ? qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(chunk.constData())) : 0);
+            spillFile.seek(spillReadOffset);
+            const QByteArray &frame = spillFile.read(qint64(length) + 4);
+            if (chunk.size() < 4 || frame.size() < qint64(length) + 4) {
+                spillFile.resize(spillReadOffset);
+                break;
+            }
+            send(frame);
+            spillReadOffset += frame.size();
+        }
+        else
+        {
+            send(chunk.left(offset));
+            spillReadOffset += offset;
+        }
+    }
+
+    if (spillFile.isOpen() && spilledBytes() == 0 && spillReadOffset > 0) {
+        spillFile.resize(0);
+        spillReadOffset = 0;
+    }
+}
+
+void TcpSink::onStateChanged(QAbstractSocket::SocketState state)
+{
+    if (state == QAbstractSocket::ConnectedState)
+    {
+        reconnectMsec = MinReconnectMsec;
+        replaySpill();
+    }
+    else if (state == QAbstractSocket::UnconnectedState)
+    {
+        spillInFlight();
+        if (!active) {
+            return;
+        }
+        reconnectTimer.start(reconnectMsec);
+        reconnectMsec = qMin(reconnectMsec * 2, int(MaxReconnectMsec));
+    }
+}
+
+void TcpSink::onBytesWritten(qint64 bytes)
+{
+    inFlightWritten += bytes;
+    while (!inFlight.isEmpty() && inFlightWritten >= inFlight.first().size()) {
+        inFlightWritten -= inFlight.takeFirst().size();
+    }
+    replaySpill();
+}
+
+QByteArray TcpSink::takeFrame(int *messages)
+{
+    *messages = batchMessages;
+    if (batch.isEmpty()) {
+        return QByteArray();
+    }
+
+    QByteArray frame(4, 0);
+    qToBigEndian<quint32>(quint32(batch.size()), reinterpret_cast<uchar *>(frame.data()));
+    frame.append(batch);
+
+    batch.clear();
+    batchMessages = 0;
+    return frame;
+}
+
+void TcpSink::spill(const QByteArray &frame, int messages)
+{
+    if (!openSpill() || spilledBytes() + frame.size() > spillLimit) {
+        droppedMessages += quint64(messages);
+        return;
+    }
+
+    spillFile.seek(spillFile.size());
+    if (spillFile.write(frame) != frame.size()) {
+        droppedMessages += quint64(messages);
+    }
+}
+
+void TcpSink::send(const QByteArray &frames)
+{
+    // Kept until the socket hands them to the kernel, Qt drops its buffer on disconnect
+    inFlight.append(frames);
+    socket.write(frames);
+}
+
+// Frames not yet written to the kernel go back in front of the spill, a partly
+// written one is resent whole
+void TcpSink::spillInFlight()
+{
+    if (inFlight.isEmpty()) {
+        return;
+    }
+
+    QByteArray frames;
+    for (const auto &chunk : inFlight) {
+        frames.append(chunk);
+    }
+    inFlight.clear();
+    inFlightWritten = 0;
+
+    const int messages = frameMessages(frames);
+    if (!openSpill() || spilledBytes() + frames.size() > spillLimit) {
+        droppedMessages += quint64(messages);
+        return;
+    }
+
+    spillFile.seek(spillReadOffset);
+    const QByteArray &rest = spillFile.readAll();
+    spillFile.resize(0);
+    spillFile.seek(0);
+    if (spillFile.write(frames) != frames.size() || spillFile.write(rest) != rest.size()) {
+        droppedMessages += quint64(messages);
+    }
+    spillReadOffset = 0;
+}
+
+void TcpSink::compactSpill()
+{
+    if (!spillFile.isOpen() || spillReadOffset == 0) {
+        return;
+    }
+
+    spillFile.seek(spillReadOffset);
+    const QByteArray &rest = spillFile.readAll();
+    spillFile.resize(0);
+    spillFile.seek(0);
+    spillFile.write(rest);
+    spillReadOffset = 0;
+}
+
+bool TcpSink::openSpill()
+{
+    if (spillFile.isOpen()) {
+        return true;
+    }
+    if (spillPath.isEmpty() || spillLimit <= 0) {
+        return false;
+    }
+
+    // Instances of the same app share the spill dir, the one holding the lock
+    // takes the common file (and what a previous run left there), others
+    // spill to own files
+    if (!spillLock)
+    {
+        spillLock.reset(new QLockFile(spillPath + ".lock"));
+        spillLock->setStaleLockTime(0);
+        spillFile.setFileName(spillLock->tryLock(0) ? spillPath
+                                                    : QString("%1.%2").arg(spillPath).arg(QCoreApplication::applicationPid()));
+    }
+
+    spillReadOffset = 0;
+    return spillFile.open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+}
+
+qint64 TcpSink::spilledBytes() const
+{
+    return (spillFile.isOpen() ? spillFile.size() - spillReadOffset : 0);
+}
+
+}
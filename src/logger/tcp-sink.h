@@ -0,0 +1,79 @@
+#ifndef QTLOGGER_TCPSINK_H
+#define QTLOGGER_TCPSINK_H
+
+#include <QTcpSocket>
+#include <QFile>
+#include <QLockFile>
+#include <QScopedPointer>
+#include <QTimer>
+
+namespace qtlogger {
+
+class TcpSink : public QObject {
+    Q_OBJECT
+public:
+    enum {
+        MaxBatchBytes =       64 * 1024,
+        BatchPeriodMsec =     5,
+        HighWaterBytes =      4 * 1024 * 1024,
+        ReplayChunkBytes =    1024 * 1024,
+        MinReconnectMsec =    100,
+        MaxReconnectMsec =    10000
+    };
+
+public:
+    explicit TcpSink(QObject *parent = nullptr);
+    ~TcpSink();
+public:
+    void setSpill(const QString &filePath, qint64 limitBytes);
+
+    void start(const QHostAddress &address, quint16 port);
+    void stop();
+    void write(const QString &msg);
+    void spillPending();
+
+    QString statusString() const;
+
+private slots:
+    void flushBatch();
+    void reconnect();
+    void replaySpill();
+    void onBytesWritten(qint64 bytes);
+    void onStateChanged(QAbstractSocket::SocketState state);
+
+private:
+    QByteArray takeFrame(int *messages);
+    void send(const QByteArray &frames);
+    void spill(const QByteArray &frame, int messages);
+    void spillInFlight();
+    void compactSpill();
+    bool openSpill();
+    qint64 spilledBytes() const;
+
+private:
+    QTcpSocket socket;
+    QHostAddress destAddress;
+    quint16 destPort = 0;
+    bool active = false;
+
+    QByteArray batch;
+    int batchMessages = 0;
+    QTimer batchTimer;
+
+    QTimer reconnectTimer;
+    int reconnectMsec = MinReconnectMsec;
+
+    QList<QByteArray> inFlight;
+    qint64 inFlightWritten = 0;
+
+    QString spillPath;
+    QScopedPointer<QLockFile> spillLock;
+    QFile spillFile;
+    qint64 spillLimit = 0;
+    qint64 spillReadOffset = 0;
+    quint64 droppedMessages = 0;
+};
+
+}
+
+#endif // QTLOGGER_TCPSINK_H
@@ -0,0 +1,204 @@
+#include "thread-file-sink.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "timestamp.h"
+
+namespace qtlogger {
+
+namespace {
+
+const char SegmentTag[] = "tid-";
+
+// Only <base-path>.tid-<tid> files are ours, <base-path>.1 may be a rotated log
+bool isSegment(const QFileInfo &info)
+{
+    const QString &suffix = info.suffix();
+    bool isTid = false;
+    suffix.mid(int(sizeof(SegmentTag)) - 1).toLongLong(&isTid);
+    return (suffix.startsWith(SegmentTag) && isTid);
+}
+
+}
+
+struct ThreadFileSink::Segment {
+    std::mutex mutex;
+    int fd = -1;
+    QByteArray buffer;
+    quint64 lastFlushNs = 0;
+    quint64 generation = 0;
+
+    void flush(quint64 nowNs)
+    {
+        for (const char *data = buffer.constData(), *end = data + buffer.size(); fd >= 0 && data < end;)
+        {
+            const ssize_t written = ::write(fd, data, size_t(end - data));
+            if (written < 0 && errno != EINTR) {
+                break;
+            }
+            data += (written > 0 ? written : 0);
+        }
+        buffer.clear();
+        lastFlushNs = nowNs;
+    }
+
+    void close()
+    {
+        flush(Timestamp::now());
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+    }
+};
+
+// Closes the segment of a finishing thread
+struct ThreadFileSink::Local {
+    std::shared_ptr<Segment> segment;
+
+    ~Local()
+    {
+        if (segment)
+        {
+            std::lock_guard<std::mutex> lock(segment->mutex);
+            segment->close();
+        }
+    }
+};
+
+ThreadFileSink::~ThreadFileSink()
+{
+    stop();
+}
+
+void ThreadFileSink::start(const QString &path, int flushPeriodMsec)
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const QFileInfo info(path);
+    for (const auto &stale : info.dir().entryInfoList(QStringList(info.fileName() + "." + SegmentTag + "*"), QDir::Files))
+    {
+        if (isSegment(stale)) {
+            QFile::remove(stale.filePath());
+        }
+    }
+
+    basePath = path;
+    flushPeriodNs.store(quint64(qMax(0, flushPeriodMsec)) * 1000000ull, std::memory_order_relaxed);
+    active = true;
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+void ThreadFileSink::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    active = false;
+    generation.fetch_add(1, std::memory_order_release);
+    for (const auto &segment : segments)
+    {
+        std::lock_guard<std::mutex> segmentLock(segment->mutex);
+        segment->close();
+    }
+    segments.clear();
+}
+
+void ThreadFileSink::flush()
+{
+    // Never waits, so it is safe from the timer and on termination while a
+    // writer holds its segment; a busy writer flushes by itself
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    const quint64 nowNs = Timestamp::now();
+    for (const auto &segment : segments)
+    {
+        std::unique_lock<std::mutex> segmentLock(segment->mutex, std::try_to_lock);
+        if (segmentLock.owns_lock() && !segment->buffer.isEmpty()) {
+            segment->flush(nowNs);
+        }
+    }
+}
+
+void ThreadFileSink::write(const QString &msg, quint64 timestampNs)
+{
+    static thread_local Local local;
+    if (!local.segment || local.segment->generation != generation.load(std::memory_order_acquire))
+    {
+        local.segment = open();
+        if (!local.segment) {
+            return;
+        }
+    }
+
+    Segment &segment = *local.segment;
+    std::lock_guard<std::mutex> lock(segment.mutex);
+    if (segment.fd < 0) {
+        return;
+    }
+
+    // Fixed width prefix, continuation lines of multiline messages are indented
+    char prefix[24];
+    snprintf(prefix, sizeof(prefix), "%020llu ", static_cast<unsigned long long>(timestampNs));
+    QByteArray text = msg.toUtf8();
+    if (text.contains('\n')) {
+        text.replace('\n', "\n\t");
+    }
+    segment.buffer.append(prefix, 21);
+    segment.buffer.append(text);
+    segment.buffer.append('\n');
+
+    // Deferred records may be stamped before the last flush
+    if (segment.buffer.size() >= FlushBytes ||
+        (timestampNs > segment.lastFlushNs && timestampNs - segment.lastFlushNs >= flushPeriodNs.load(std::memory_order_relaxed))) {
+        segment.flush(timestampNs);
+    }
+}
+
+QString ThreadFileSink::statusString() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return QString("Writing in per thread files %1.tid-<tid>, %2 threads").arg(basePath).arg(segments.size());
+}
+
+std::shared_ptr<ThreadFileSink::Segment> ThreadFileSink::open()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!active) {
+        return std::shared_ptr<Segment>();
+    }
+
+    for (auto it = segments.begin(); it != segments.end();)
+    {
+        bool closed = false;
+        {
+            std::lock_guard<std::mutex> segmentLock((*it)->mutex);
+            closed = ((*it)->fd < 0);
+        }
+        it = (closed ? segments.erase(it) : it + 1);
+    }
+
+    std::shared_ptr<Segment> segment(new Segment);
+    const QString &path = QString("%1.%2%3").arg(basePath).arg(SegmentTag).arg(long(syscall(SYS_gettid)));
+    segment->fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (segment->fd < 0) {
+        return std::shared_ptr<Segment>();
+    }
+
+    segment->lastFlushNs = Timestamp::now();
+    segment->generation = generation.load(std::memory_order_acquire);
+    segments.push_back(segment);
+    return segment;
+}
+
+}
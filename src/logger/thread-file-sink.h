@@ -0,0 +1,47 @@
+#ifndef QTLOGGER_THREADFILESINK_H
+#define QTLOGGER_THREADFILESINK_H
+
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace qtlogger {
+
+class ThreadFileSink {
+public:
+    enum {
+        FlushBytes = 64 * 1024
+    };
+
+public:
+    ~ThreadFileSink();
+public:
+    void start(const QString &basePath, int flushPeriodMsec);
+    void stop();
+    void flush();
+    void write(const QString &msg, quint64 timestampNs);
+
+    QString statusString() const;
+
+private:
+    struct Segment;
+    struct Local;
+
+    std::shared_ptr<Segment> open();
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<Segment>> segments;
+    QString basePath;
+    bool active = false;
+
+    std::atomic<quint64> generation { 0 };
+    std::atomic<quint64> flushPeriodNs { 0 };
+};
+
+}
+
+#endif // QTLOGGER_THREADFILESINK_H
@@ -0,0 +1,135 @@
+#include "timestamp.h"
+
+#include <stdio.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace qtlogger {
+
+namespace {
+
+const quint64 TickCalibrationNs = 50000000ull;
+
+#if defined(__x86_64__)
+bool invariantTsc()
+{
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    return (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)));
+}
+
+void sample(quint64 *tscValue, quint64 *monotonicValue)
+{
+    quint64 narrowest = ~0ull;
+    for (int i = 0; i < 8; ++i)
+    {
+        const quint64 before = __rdtsc();
+        const quint64 monotonic = Timestamp::monotonicNow();
+        const quint64 after = __rdtsc();
+        if (after - before < narrowest)
+        {
+            narrowest = after - before;
+            *tscValue = before + (after - before) / 2;
+            *monotonicValue = monotonic;
+        }
+    }
+}
+#endif
+
+// Ticks are calibrated lazily against this startup sample instead of
+// sleeping in a static initializer
+struct TickAnchor {
+    quint64 tsc = 0;
+    quint64 monotonic = 0;
+
+    TickAnchor()
+    {
+#if defined(__x86_64__)
+        sample(&tsc, &monotonic);
+#endif
+    }
+};
+
+const TickAnchor anchor;
+
+}
+
+#if defined(__x86_64__)
+const bool Timestamp::tscTicks = invariantTsc();
+#else
+const bool Timestamp::tscTicks = false;
+#endif
+std::atomic<quint64> Timestamp::nsPerTickFixed32 { 0 };
+
+// Kept out of line so that QTLOGGER_TSC_CLOCK only has to be consistent within the library
+quint64 Timestamp::now()
+{
+#if defined(QTLOGGER_TSC_CLOCK) && defined(__x86_64__)
+    if (tscTicks) {
+        return anchor.monotonic + ticksToNs(__rdtsc() - anchor.tsc);
+    }
+#endif
+    return monotonicNow();
+}
+
+// Until enough time has passed since startup the scale is estimated on every
+// call against the current sample, so now() follows CLOCK_MONOTONIC, then it is fixed
+quint64 Timestamp::calibrateTicks(quint64 ticks)
+{
+#if defined(__x86_64__)
+    quint64 tscValue = 0, monotonicValue = 0;
+    sample(&tscValue, &monotonicValue);
+    if (tscValue <= anchor.tsc || monotonicValue <= anchor.monotonic) {
+        return 0;
+    }
+
+    const quint64 scale = quint64((static_cast<unsigned __int128>(monotonicValue - anchor.monotonic) << 32) / (tscValue - anchor.tsc));
+    if (monotonicValue - anchor.monotonic >= TickCalibrationNs) {
+        nsPerTickFixed32.store(scale, std::memory_order_relaxed);
+    }
+    return quint64((static_cast<unsigned __int128>(ticks) * scale) >> 32);
+#else
+    return ticks;
+#endif
+}
+
+qint64 Timestamp::epochNs(quint64 timestampNs)
+{
+    timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    const qint64 ageNs = qint64(now()) - qint64(timestampNs);
+    return qint64(real.tv_sec) * 1000000000ll + qint64(real.tv_nsec) - ageNs;
+}
+
+QString Timestamp::timeString(quint64 timestampNs)
+{
+    const qint64 epoch = epochNs(timestampNs);
+    const time_t seconds = time_t(epoch / 1000000000ll);
+    const int micros = int((epoch % 1000000000ll) / 1000);
+
+    static thread_local time_t cachedSeconds = -1;
+    static thread_local char cachedString[16];
+    if (seconds != cachedSeconds)
+    {
+        tm local;
+        localtime_r(&seconds, &local);
+        strftime(cachedString, sizeof(cachedString), "%H:%M:%S", &local);
+        cachedSeconds = seconds;
+    }
+
+    char string[32];
+    snprintf(string, sizeof(string), "%s.%06d", cachedString, micros);
+    return QString::fromLatin1(string);
+}
+
+QString Timestamp::sourceString()
+{
+#if defined(QTLOGGER_TSC_CLOCK)
+    return (tscTicks ? QString("tsc") : QString("monotonic"));
+#else
+    return QString("monotonic");
+#endif
+}
+
+}
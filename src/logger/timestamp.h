@@ -0,0 +1,65 @@
+#ifndef QTLOGGER_TIMESTAMP_H
+#define QTLOGGER_TIMESTAMP_H
+
+#include <QString>
+
+#include <atomic>
+
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace qtlogger {
+
+class Timestamp {
+public:
+    static quint64 now();
+
+    static quint64 monotonicNow()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return quint64(ts.tv_sec) * 1000000000ull + quint64(ts.tv_nsec);
+    }
+
+    // Cheapest counter for short intervals: invariant TSC when the CPU has one
+    // whatever clock now() uses, nanoseconds of CLOCK_MONOTONIC otherwise
+    static quint64 ticks()
+    {
+#if defined(__x86_64__)
+        if (tscTicks) {
+            return __rdtsc();
+        }
+#endif
+        return monotonicNow();
+    }
+
+    static quint64 ticksToNs(quint64 ticks)
+    {
+#if defined(__x86_64__)
+        if (tscTicks)
+        {
+            const quint64 scale = nsPerTickFixed32.load(std::memory_order_relaxed);
+            return (scale ? quint64((static_cast<unsigned __int128>(ticks) * scale) >> 32) : calibrateTicks(ticks));
+        }
+#endif
+        return ticks;
+    }
+
+    static qint64 epochNs(quint64 timestampNs);
+    static QString timeString(quint64 timestampNs);
+    static QString sourceString();
+
+private:
+    static quint64 calibrateTicks(quint64 ticks);
+
+private:
+    static const bool tscTicks;
+    static std::atomic<quint64> nsPerTickFixed32;
+};
+
+}
+
+#endif // QTLOGGER_TIMESTAMP_H
@@ -0,0 +1,176 @@
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+#include <QTime>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+#include "logger/message-filter.h"
+#include "logger/scope.h"
+#include "logger/thread-file-sink.h"
+#include "logger/timestamp.h"
+
+using qtlogger::MessageFilter;
+using qtlogger::ThreadFileSink;
+using qtlogger::Timestamp;
+
+namespace {
+
+const int Iterations = 1000000;
+volatile quint64 sink = 0;
+
+template<typename Function>
+void bench(const char *name, Function function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < Iterations; ++i) {
+        function();
+    }
+    const auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-52s %9.1f ns/call\n", name, double(elapsedNs) / Iterations);
+}
+
+template<typename Function>
+void resolution(const char *name, Function function)
+{
+    quint64 finest = ~0ull;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const quint64 first = function();
+        quint64 next = function();
+        while (next == first) {
+            next = function();
+        }
+        finest = qMin(finest, next - first);
+    }
+    printf("  %-52s %9llu ns\n", name, static_cast<unsigned long long>(finest));
+}
+
+void timestamps()
+{
+    printf("Timestamp source: %s\n", qPrintable(Timestamp::sourceString()));
+
+    printf("Per call cost\n");
+    bench("QTime::currentTime()",                            []() { sink += quint64(QTime::currentTime().msec()); });
+    bench("QTime::currentTime().toString(\"hh:mm:ss.zzz\")",  []() { sink += quint64(QTime::currentTime().toString("hh:mm:ss.zzz").size()); });
+    bench("Timestamp::monotonicNow()",                       []() { sink += Timestamp::monotonicNow(); });
+    bench("Timestamp::now()",                                []() { sink += Timestamp::now(); });
+    bench("Timestamp::ticks()",                              []() { sink += Timestamp::ticks(); });
+    bench("Timestamp::timeString(Timestamp::now())",         []() { sink += quint64(Timestamp::timeString(Timestamp::now()).size()); });
+
+    printf("Resolution\n");
+    resolution("QTime::currentTime()", []() { return quint64(QTime::currentTime().msecsSinceStartOfDay()) * 1000000ull; });
+    resolution("Timestamp::now()",     []() { return Timestamp::now(); });
+}
+
+void messageFilter()
+{
+    const QString msg = QString("Order book snapshot for instrument %1 received from gateway, %2 levels, sequence %3, latency within limits")
+                                .arg("XBT-PERP").arg(25).arg(918273645);
+
+    printf("Message filter, %d chars message without matches\n", msg.size());
+    for (int count : { 1, 4, 16 })
+    {
+        QStringList patterns;
+        MessageFilter filter;
+        for (int i = 0; i < count; ++i)
+        {
+            patterns.append(QString("order id %1\\d+").arg(1000 + i * 37));
+            filter.add(patterns.last());
+        }
+
+        bench(qPrintable(QString("QRegExp per pattern, %1 patterns").arg(count)), [&patterns, &msg]()
+        {
+            for (const auto &pattern : patterns) {
+                QRegExp rx(pattern);
+                sink += quint64(rx.indexIn(msg) + 1);
+            }
+        });
+        bench(qPrintable(QString("MessageFilter::pass(), %1 patterns").arg(count)), [&filter, &msg]() { sink += quint64(filter.pass(msg)); });
+    }
+}
+
+template<typename Function>
+void throughput(const char *name, int threads, Function function)
+{
+    const int perThread = Iterations / 4;
+    std::vector<std::thread> writers;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i)
+    {
+        writers.push_back(std::thread([&function, perThread]()
+        {
+            for (int k = 0; k < perThread; ++k) {
+                function(k);
+            }
+        }));
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    const auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-40s %2d threads %9.2f Mmsg/s\n", name, threads, double(threads) * perThread * 1e3 / double(elapsedNs));
+}
+
+void scopes()
+{
+    printf("Scoped latency\n");
+    bench("Timestamp::now() twice",                  []() { sink += Timestamp::now() - Timestamp::now(); });
+    bench("QTLOG_SCOPE(\"bench\")",                   []() { QTLOG_SCOPE("bench"); });
+    bench("qtlogger::scope::record()",               []() { static const qtlogger::scope::Site site("bench.record"); qtlogger::scope::record(site.id, sink++ & 0xffff); });
+}
+
+void threadFiles()
+{
+    const QString msg = QString("[12:00:00.000000] INFO <bench> Order book snapshot for instrument XBT-PERP received, 25 levels");
+    const QString basePath = QDir(QDir::tempPath()).filePath("qtlogger-bench.log");
+
+    printf("File echo throughput\n");
+    for (int threads : { 1, 2, 4, 8 })
+    {
+        QFile file(basePath);
+        file.open(QFile::WriteOnly);
+        QTextStream stream(&file);
+        std::mutex mutex;
+        throughput("Shared QTextStream under mutex", threads, [&stream, &mutex, &msg](int) -> void
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stream << msg << "\n";
+        });
+        stream.flush();
+        file.remove();
+
+        ThreadFileSink sink;
+        sink.start(basePath, 5000);
+        throughput("ThreadFileSink", threads, [&sink, &msg](int) -> void
+        {
+            sink.write(msg, Timestamp::now());
+        });
+        sink.stop();
+
+        const QDir dir(QDir::tempPath());
+        for (const auto &segment : dir.entryList(QStringList("qtlogger-bench.log.*"), QDir::Files)) {
+            QFile::remove(dir.filePath(segment));
+        }
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Q_UNUSED(argc)
+    Q_UNUSED(argv)
+
+    timestamps();
+    messageFilter();
+    scopes();
+    threadFiles();
+    return 0;
+}
@@ -15,11 +15,15 @@ int main(int argc, char *argv[])
     QTimer timerWarning;
     QObject::connect(&timerWarning, &QTimer::timeout, []() -> void { static int i = 0; qWarning() << "Some warning" << i++; });
 
+    QTimer timerDeferred;
+    QObject::connect(&timerDeferred, &QTimer::timeout, []() -> void { static int i = 0; QTLOG_SCOPE("test-app.deferred"); QTLOG_INFO("Some deferred info {} ratio {}", i, i / 3.); ++i; });
+
     QTimer timerCritical;
     QObject::connect(&timerCritical, &QTimer::timeout, []() -> void { static int i = 0; qCritical() << "Some critical" << i++; });
 
     timerDebug.start(100);
     timerWarning.start(1000);
+    timerDeferred.start(500);
     timerCritical.start(4000);
 
     return app.exec();
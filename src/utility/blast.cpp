@@ -0,0 +1,283 @@
+#include "blast.h"
+
+#include <QCoreApplication>
+#include <QUdpSocket>
+#include <QTcpSocket>
+#include <QtEndian>
+#include <QSettings>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "logger/destination.h"
+
+namespace {
+
+qint64 monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+quint16 settingsPort(const char *key)
+{
+    return quint16(QSettings(CONFIG_PATH "/.qtlogger-rc", QSettings::NativeFormat).value(key).toInt());
+}
+
+bool writeFrame(QTcpSocket *socket, const QByteArray &payload)
+{
+    QByteArray frame(4, 0);
+    qToBigEndian<quint32>(quint32(payload.size()), reinterpret_cast<uchar *>(frame.data()));
+    frame.append(payload);
+
+    if (socket->write(frame) != frame.size()) {
+        return false;
+    }
+    socket->flush();
+    while (socket->bytesToWrite() > 4 * 1024 * 1024 && socket->waitForBytesWritten(1000)) {}
+    return true;
+}
+
+bool parseSize(const QString &string, int *minSize, int *maxSize)
+{
+    const auto &tupple = string.split("-", QString::SkipEmptyParts);
+    bool minOk = false;
+    bool maxOk = false;
+    *minSize = tupple.value(0).toInt(&minOk);
+    *maxSize = (tupple.size() == 2 ? tupple.at(1).toInt(&maxOk) : *minSize);
+    if (tupple.size() == 1) {
+        maxOk = minOk;
+    }
+    return (minOk && maxOk && *minSize > 0 && *minSize <= *maxSize);
+}
+
+}
+
+int blast(const QStringList &args)
+{
+    QStringList params = args.mid(2);
+    const bool tcp = (params.value(0) == QString("tcp"));
+    if (tcp || params.value(0) == QString("udp")) {
+        params.removeFirst();
+    }
+
+    QHostAddress address(QHostAddress::LocalHost);
+    quint16 port = settingsPort("default-dest-port");
+    if (params.size() > 0 && !qtlogger::parseDestination(params.at(0), &address, &port)) {
+        qCritical("Invalid destination \"%s\", expected [address:][port]", qPrintable(params.at(0)));
+        return EXIT_FAILURE;
+    }
+
+    const double rate = (params.size() > 1 ? params.at(1).toDouble() : 10000.);
+    int minSize = 128;
+    int maxSize = 128;
+    if (params.size() > 2 && !parseSize(params.at(2), &minSize, &maxSize)) {
+        qCritical("Invalid size \"%s\", expected <bytes> or <min>-<max>", qPrintable(params.at(2)));
+        return EXIT_FAILURE;
+    }
+    const int senderCount = qMax(1, (params.size() > 3 ? params.at(3).toInt() : 1));
+    const double durationSec = (params.size() > 4 ? params.at(4).toDouble() : 10.);
+    if (rate <= 0. || durationSec <= 0.) {
+        qCritical("Rate and duration should be positive");
+        return EXIT_FAILURE;
+    }
+
+    qInfo(" ***** Blasting %s %s:%u at %.0f msg/s, %d-%d bytes, %d sender(s) for %.1f s *****",
+          (tcp ? "tcp" : "udp"), qPrintable(address.toString()), port, rate, minSize, maxSize, senderCount, durationSec);
+
+    std::atomic<quint64> sent(0);
+    std::atomic<quint64> failed(0);
+    std::atomic<quint64> bytes(0);
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    const qint64 startNs = monotonicNs();
+    const qint64 stopNs = startNs + qint64(durationSec * 1e9);
+    const qint64 periodNs = qMax<qint64>(1, qint64(1e9 * senderCount / rate));
+
+    std::vector<std::thread> senders;
+    for (int i = 0; i < senderCount; ++i)
+    {
+        senders.emplace_back([=, &sent, &failed, &bytes]() -> void
+        {
+            QUdpSocket udpSocket;
+            QTcpSocket tcpSocket;
+            if (tcp)
+            {
+                tcpSocket.connectToHost(address, port);
+                if (!tcpSocket.waitForConnected(3000)) {
+                    qCritical(" ***** Sender %d connection failed, %s *****", i, qPrintable(tcpSocket.errorString()));
+                    ++failed;
+                    return;
+                }
+            }
+
+            std::mt19937 random(std::random_device()() + unsigned(i));
+            std::uniform_int_distribution<int> size(minSize, maxSize);
+            const QByteArray sender = pid + "." + QByteArray::number(i);
+
+            QByteArray datagram;
+            quint64 seq = 0;
+            qint64 deadlineNs = startNs + periodNs * i / senderCount;
+            for (qint64 nowNs = monotonicNs(); nowNs < stopNs; nowNs = monotonicNs())
+            {
+                if (deadlineNs > nowNs) {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(deadlineNs - nowNs));
+                }
+
+                datagram = BLAST_TAG " " + sender + " " + QByteArray::number(seq++) + " " + QByteArray::number(monotonicNs()) + " ";
+                const int length = size(random) - 1;
+                if (datagram.size() < length) {
+                    datagram.append(QByteArray(length - datagram.size(), 'x'));
+                }
+                datagram.append('\n');
+
+                const bool written = (tcp ? writeFrame(&tcpSocket, datagram)
+                                          : (udpSocket.writeDatagram(datagram, address, port) >= 0));
+                if (!written) {
+                    ++failed;
+                } else {
+                    ++sent;
+                    bytes += quint64(datagram.size());
+                }
+                deadlineNs += periodNs;
+            }
+
+            if (tcp)
+            {
+                while (tcpSocket.bytesToWrite() > 0 && tcpSocket.waitForBytesWritten(1000)) {}
+                tcpSocket.disconnectFromHost();
+            }
+        });
+    }
+
+    for (auto &sender : senders) {
+        sender.join();
+    }
+
+    const double elapsedSec = (monotonicNs() - startNs) / 1e9;
+    qInfo(" ***** Sent %llu messages (%.0f msg/s, %.1f KiB/s), %llu failed *****",
+          static_cast<unsigned long long>(sent.load()),
+          sent.load() / elapsedSec,
+          bytes.load() / 1024. / elapsedSec,
+          static_cast<unsigned long long>(failed.load()));
+
+    return (failed.load() ? EXIT_FAILURE : 0);
+}
+
+int blastCommands(const QStringList &args)
+{
+    if (args.size() < 8) {
+        qCritical("Usage: blast command <burst-size> <bursts> <period-msec> \"[hostname:]<app>\" <command> [args]");
+        return EXIT_FAILURE;
+    }
+
+    const int burstSize = qMax(1, args.at(3).toInt());
+    const int bursts = qMax(1, args.at(4).toInt());
+    const int periodMsec = qMax(0, args.at(5).toInt());
+    const QByteArray datagram = args.mid(6).join(" ").toLocal8Bit();
+    const quint16 port = settingsPort("command-port");
+
+    QUdpSocket socket;
+    quint64 failed = 0;
+    for (int burst = 0; burst < bursts; ++burst)
+    {
+        if (burst > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(periodMsec));
+        }
+        for (int i = 0; i < burstSize; ++i)
+        {
+            if (socket.writeDatagram(datagram, QHostAddress(QHostAddress::Broadcast), port) < 0) {
+                ++failed;
+            }
+        }
+    }
+    socket.waitForBytesWritten();
+
+    qInfo(" ***** Sent %d bursts of %d commands, %llu failed *****", bursts, burstSize, static_cast<unsigned long long>(failed));
+    return (failed ? EXIT_FAILURE : 0);
+}
+
+bool BlastStats::consume(const QByteArray &line)
+{
+    const int tag = line.indexOf(BLAST_TAG " ");
+    if (tag == -1) {
+        return false;
+    }
+
+    const int senderBegin = tag + int(sizeof(BLAST_TAG));
+    const int seqBegin = line.indexOf(' ', senderBegin) + 1;
+    const int nsBegin = (seqBegin > 0 ? line.indexOf(' ', seqBegin) + 1 : 0);
+    const int nsEnd = (nsBegin > 0 ? line.indexOf(' ', nsBegin) : -1);
+    if (nsBegin <= 0) {
+        return false;
+    }
+
+    bool seqOk = false;
+    bool nsOk = false;
+    const quint64 seq = line.mid(seqBegin, nsBegin - seqBegin - 1).toULongLong(&seqOk);
+    const qint64 sentNs = line.mid(nsBegin, (nsEnd == -1 ? -1 : nsEnd - nsBegin)).toLongLong(&nsOk);
+    if (!seqOk || !nsOk) {
+        return false;
+    }
+
+    auto &sender = senders[line.mid(senderBegin, seqBegin - senderBegin - 1)];
+    if (seq >= sender.nextSeq)
+    {
+        sender.lost += seq - sender.nextSeq;
+        intervalLost += seq - sender.nextSeq;
+        totalLost += seq - sender.nextSeq;
+        sender.nextSeq = seq + 1;
+    }
+    else
+    {
+        ++intervalReordered;
+        if (sender.lost > 0) {
+            --sender.lost;
+            --totalLost;
+        }
+    }
+    ++sender.received;
+
+    const quint64 latencyNs = quint64(qMax<qint64>(0, monotonicNs() - sentNs));
+    intervalLatencySumNs += latencyNs;
+    intervalLatencyMaxNs = qMax(intervalLatencyMaxNs, latencyNs);
+    intervalBytes += quint64(line.size()) + 1;
+    ++intervalMessages;
+    ++totalMessages;
+    return true;
+}
+
+bool BlastStats::isIdle() const
+{
+    return (intervalMessages == 0 && intervalLost == 0);
+}
+
+QString BlastStats::report()
+{
+    const qint64 nowNs = monotonicNs();
+    const double seconds = (intervalStartNs ? (nowNs - intervalStartNs) / 1e9 : 1.);
+    const quint64 expected = totalMessages + totalLost;
+
+    const QString &string = QString("rx %1 msg/s  %2 KiB/s  lost %3  reordered %4  latency avg %5 us max %6 us  |  total %7  lost %8 (%9%)  senders %10")
+                                   .arg(intervalMessages / seconds, 0, 'f', 0)
+                                   .arg(intervalBytes / 1024. / seconds, 0, 'f', 1)
+                                   .arg(intervalLost)
+                                   .arg(intervalReordered)
+                                   .arg(intervalMessages ? intervalLatencySumNs / 1000. / intervalMessages : 0., 0, 'f', 1)
+                                   .arg(intervalLatencyMaxNs / 1000., 0, 'f', 1)
+                                   .arg(totalMessages)
+                                   .arg(totalLost)
+                                   .arg(expected ? 100. * totalLost / expected : 0., 0, 'f', 3)
+                                   .arg(senders.size());
+
+    intervalMessages = 0;
+    intervalBytes = 0;
+    intervalLost = 0;
+    intervalReordered = 0;
+    intervalLatencySumNs = 0;
+    intervalLatencyMaxNs = 0;
+    intervalStartNs = nowNs;
+    return string;
+}
@@ -0,0 +1,40 @@
+#ifndef QTLOGGER_UTILITY_BLAST_H
+#define QTLOGGER_UTILITY_BLAST_H
+
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+
+#define BLAST_TAG "qtl-blast"
+
+int blast(const QStringList &args);
+int blastCommands(const QStringList &args);
+
+class BlastStats {
+public:
+    bool consume(const QByteArray &line);
+    bool isIdle() const;
+    QString report();
+
+private:
+    struct Sender {
+        quint64 nextSeq = 0;
+        quint64 received = 0;
+        quint64 lost = 0;
+    };
+
+    QHash<QByteArray, Sender> senders;
+
+    quint64 intervalMessages = 0;
+    quint64 intervalBytes = 0;
+    quint64 intervalLost = 0;
+    quint64 intervalReordered = 0;
+    quint64 intervalLatencySumNs = 0;
+    quint64 intervalLatencyMaxNs = 0;
+
+    quint64 totalMessages = 0;
+    quint64 totalLost = 0;
+    qint64 intervalStartNs = 0;
+};
+
+#endif // QTLOGGER_UTILITY_BLAST_H
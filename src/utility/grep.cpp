@@ -0,0 +1,701 @@
+#include "grep.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegExp>
+#include <QRegularExpression>
+#include <QThread>
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const qint64 ChunkBytes = 4 * 1024 * 1024;
+const int ChunksPerThread = 4;
+const int SequenceDigits = 20;
+const char SegmentTag[] = "tid-";
+
+enum Level {
+    Debug =    1,
+    Info =     1 << 1,
+    Warning =  1 << 2,
+    Critical = 1 << 3,
+    Fatal =    1 << 4
+};
+
+struct Options {
+    quint32 levels = 0;
+    QString app;
+    QByteArray from;
+    QByteArray to;
+    QString pattern;
+    bool strip = false;
+    bool merge = false;
+    bool sequenced = false;
+    bool keepSequence = false;
+    int threads = QThread::idealThreadCount();
+    QStringList paths;
+};
+
+struct Record {
+    const char *time = nullptr;
+    int timeSize = 0;
+    quint32 level = 0;
+    const char *app = nullptr;
+    int appSize = 0;
+    const char *message = nullptr;
+    int messageSize = 0;
+};
+
+quint32 levelFromTag(const char *tag)
+{
+    if (memcmp(tag, "DEBG", 4) == 0) { return Debug; }
+    if (memcmp(tag, "INFO", 4) == 0) { return Info; }
+    if (memcmp(tag, "WARN", 4) == 0) { return Warning; }
+    if (memcmp(tag, "CRIT", 4) == 0) { return Critical; }
+    if (memcmp(tag, "FATL", 4) == 0) { return Fatal; }
+    return 0;
+}
+
+int stripAnsi(const char *line, int size, char *out)
+{
+    int length = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (line[i] == '\x1b' && i + 1 < size && line[i + 1] == '[')
+        {
+            i += 2;
+            while (i < size && !((line[i] >= '@' && line[i] <= '~'))) { ++i; }
+            continue;
+        }
+        out[length++] = line[i];
+    }
+    return length;
+}
+
+// "[hh:mm:ss.uuuuuu] LEVL <app> message" with colour codes stripped
+bool parse(const char *line, int size, Record *record)
+{
+    if (size < 1 || line[0] != '[') {
+        return false;
+    }
+
+    const char *timeEnd = static_cast<const char *>(memchr(line, ']', size_t(size)));
+    if (!timeEnd || (line + size) - timeEnd < 8 || timeEnd[1] != ' ' || timeEnd[6] != ' ' || timeEnd[7] != '<') {
+        return false;
+    }
+
+    record->time = line + 1;
+    record->timeSize = int(timeEnd - record->time);
+    record->level = levelFromTag(timeEnd + 2);
+    record->app = timeEnd + 8;
+
+    const char *appEnd = static_cast<const char *>(memchr(record->app, '>', size_t((line + size) - record->app)));
+    if (!record->level || !appEnd) {
+        return false;
+    }
+
+    record->appSize = int(appEnd - record->app);
+    record->message = qMin(appEnd + 2, line + size);
+    record->messageSize = int((line + size) - record->message);
+    return true;
+}
+
+bool timestampKey(const char *line, int size, QByteArray *key)
+{
+    char stripped[64];
+    const int length = stripAnsi(line, qMin(size, int(sizeof(stripped))), stripped);
+    const char *end = static_cast<const char *>(memchr(stripped, ']', size_t(length)));
+    if (length < 1 || stripped[0] != '[' || !end) {
+        return false;
+    }
+
+    *key = QByteArray(stripped + 1, int(end - stripped - 1));
+    return true;
+}
+
+// Per thread segment lines are prefixed by 20 digits of monotonic nanoseconds
+int sequencePrefix(const char *line, int size)
+{
+    if (size <= SequenceDigits || line[SequenceDigits] != ' ') {
+        return 0;
+    }
+    for (int i = 0; i < SequenceDigits; ++i)
+    {
+        if (line[i] < '0' || line[i] > '9') {
+            return 0;
+        }
+    }
+    return SequenceDigits + 1;
+}
+
+// Deferred records of all threads are written by one backend thread, so
+// its segment is ordered per producer only
+bool ordered(const char *data, qint64 size)
+{
+    QByteArray last;
+    for (const char *line = data, *end = data + size; line < end;)
+    {
+        const char *lineEnd = static_cast<const char *>(memchr(line, '\n', size_t(end - line)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        if (sequencePrefix(line, int(lineEnd - line)) > 0)
+        {
+            if (!last.isEmpty() && memcmp(line, last.constData(), SequenceDigits) < 0) {
+                return false;
+            }
+            last = QByteArray(line, SequenceDigits);
+        }
+        line = lineEnd + 1;
+    }
+    return true;
+}
+
+bool isSegment(const QFileInfo &info)
+{
+    const QString &suffix = info.suffix();
+    bool isTid = false;
+    suffix.mid(int(sizeof(SegmentTag)) - 1).toLongLong(&isTid);
+    return (suffix.startsWith(SegmentTag) && isTid);
+}
+
+int compareTime(const Record &record, const QByteArray &time)
+{
+    const int result = memcmp(record.time, time.constData(), size_t(qMin(record.timeSize, time.size())));
+    return (result != 0 ? result : (record.timeSize < time.size() ? -1 : 0));
+}
+
+class Matcher {
+public:
+    explicit Matcher(const Options &options) :
+        options(options),
+        appRx(options.app),
+        messageRx(options.pattern)
+    {
+        messageRx.optimize();
+    }
+
+    bool structured() const
+    {
+        return (options.levels || !options.app.isEmpty() || !options.from.isEmpty() || !options.to.isEmpty());
+    }
+
+    void scan(const char *begin, const char *end, QByteArray *output)
+    {
+        for (const char *line = begin; line < end;)
+        {
+            const char *lineEnd = static_cast<const char *>(memchr(line, '\n', size_t(end - line)));
+            if (!lineEnd) {
+                lineEnd = end;
+            }
+
+            const int size = int(lineEnd - line);
+            const bool colored = (memchr(line, '\x1b', size_t(size)) != nullptr);
+            const char *plain = line;
+            int plainSize = size;
+            if (colored)
+            {
+                if (int(buffer.size()) < size) {
+                    buffer.resize(size_t(size));
+                }
+                plainSize = stripAnsi(line, size, buffer.data());
+                plain = buffer.data();
+            }
+
+            const int prefix = (options.sequenced ? sequencePrefix(plain, plainSize) : 0);
+            if (match(plain + prefix, plainSize - prefix))
+            {
+                if (options.strip) {
+                    output->append(plain, plainSize);
+                } else {
+                    output->append(line, size);
+                }
+                output->append('\n');
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+private:
+    bool match(const char *line, int size)
+    {
+        Record record;
+        if (!parse(line, size, &record))
+        {
+            if (structured()) {
+                return false;
+            }
+            record.message = line;
+            record.messageSize = size;
+        }
+        else
+        {
+            if (options.levels && !(options.levels & record.level)) {
+                return false;
+            }
+
+            if (!options.from.isEmpty() && compareTime(record, options.from) < 0) {
+                return false;
+            }
+            if (!options.to.isEmpty() && compareTime(record, options.to) > 0) {
+                return false;
+            }
+
+            if (!options.app.isEmpty() && !matchApp(QByteArray(record.app, record.appSize))) {
+                return false;
+            }
+        }
+
+        if (options.pattern.isEmpty()) {
+            return true;
+        }
+        return messageRx.match(QString::fromUtf8(record.message, record.messageSize)).hasMatch();
+    }
+
+    bool matchApp(const QByteArray &app)
+    {
+        auto it = apps.find(app);
+        if (it == apps.end()) {
+            it = apps.insert(app, appRx.match(QString::fromUtf8(app)).hasMatch());
+        }
+        return it.value();
+    }
+
+private:
+    const Options &options;
+    QRegularExpression appRx;
+    QRegularExpression messageRx;
+    QHash<QByteArray, bool> apps;
+    std::vector<char> buffer;
+};
+
+// Files are split into line aligned chunks, filtered by a pool of threads
+// and handed out in the original order of each file
+class Scanner {
+public:
+    explicit Scanner(const Options &options) :
+        options(options)
+    {
+        for (const auto &path : options.paths)
+        {
+            std::unique_ptr<Source> source(new Source);
+            source->file.setFileName(path);
+            if (!source->file.open(QIODevice::ReadOnly)) {
+                fprintf(stderr, "qtl: %s: %s\n", qPrintable(path), qPrintable(source->file.errorString()));
+                continue;
+            }
+
+            const qint64 size = source->file.size();
+            const char *data = (size > 0 ? reinterpret_cast<const char *>(source->file.map(0, size)) : nullptr);
+            if (size > 0 && !data) {
+                fprintf(stderr, "qtl: %s: %s\n", qPrintable(path), qPrintable(source->file.errorString()));
+                continue;
+            }
+
+            for (qint64 begin = 0; begin < size;)
+            {
+                qint64 end = qMin(begin + ChunkBytes, size);
+                if (end < size)
+                {
+                    const char *newline = static_cast<const char *>(memchr(data + end, '\n', size_t(size - end)));
+                    end = (newline ? (newline - data) + 1 : size);
+                }
+
+                Chunk chunk;
+                chunk.begin = data + begin;
+                chunk.end = data + end;
+                source->chunks.push_back(chunk);
+                begin = end;
+            }
+            source->ordered = (!options.sequenced || ordered(data, size));
+            sources.push_back(std::move(source));
+        }
+
+        window = qMax(1, options.threads) * ChunksPerThread;
+        for (int i = 0; i < qMax(1, options.threads); ++i) {
+            workers.push_back(std::thread(&Scanner::work, this));
+        }
+    }
+
+    ~Scanner()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        changed.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    int sourceCount() const
+    {
+        return int(sources.size());
+    }
+
+    bool isOrdered(int index) const
+    {
+        return sources.at(size_t(index))->ordered;
+    }
+
+    bool take(int index, QByteArray *output)
+    {
+        Source &source = *sources.at(size_t(index));
+        std::unique_lock<std::mutex> lock(mutex);
+        if (source.taken == int(source.chunks.size())) {
+            return false;
+        }
+
+        Chunk &chunk = source.chunks.at(size_t(source.taken));
+        changed.wait(lock, [&chunk]() { return chunk.done; });
+        output->swap(chunk.output);
+        chunk.output = QByteArray();
+        ++source.taken;
+        changed.notify_all();
+        return true;
+    }
+
+private:
+    struct Chunk {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        QByteArray output;
+        bool done = false;
+    };
+    struct Source {
+        QFile file;
+        std::vector<Chunk> chunks;
+        int dispatched = 0;
+        int taken = 0;
+        bool ordered = true;
+    };
+
+    void work()
+    {
+        Matcher matcher(options);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopped)
+        {
+            Chunk *chunk = nullptr;
+            bool pending = false;
+            for (auto &source : sources)
+            {
+                if (source->dispatched == int(source->chunks.size())) {
+                    continue;
+                }
+                pending = true;
+                if (source->dispatched < source->taken + window)
+                {
+                    chunk = &source->chunks.at(size_t(source->dispatched++));
+                    break;
+                }
+            }
+
+            if (!pending) {
+                return;
+            }
+            if (!chunk) {
+                changed.wait(lock);
+                continue;
+            }
+
+            lock.unlock();
+            QByteArray output;
+            matcher.scan(chunk->begin, chunk->end, &output);
+            lock.lock();
+
+            chunk->output.swap(output);
+            chunk->done = true;
+            changed.notify_all();
+        }
+    }
+
+private:
+    const Options &options;
+    std::vector<std::unique_ptr<Source>> sources;
+    std::vector<std::thread> workers;
+    int window = ChunksPerThread;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool stopped = false;
+};
+
+class Cursor {
+public:
+    Cursor(Scanner *scanner, int source, bool sequenced) :
+        scanner(scanner),
+        source(source),
+        sequenced(sequenced),
+        sorting(sequenced && !scanner->isOrdered(source))
+    {}
+
+    bool next()
+    {
+        if (sorting) {
+            return nextSorted();
+        }
+
+        while (pos >= chunk.size())
+        {
+            pos = 0;
+            if (!scanner->take(source, &chunk)) {
+                return false;
+            }
+        }
+
+        line = chunk.constData() + pos;
+        const char *end = static_cast<const char *>(memchr(line, '\n', size_t(chunk.size() - pos)));
+        size = int(end - line) + 1;
+        pos += size;
+
+        // Lines without timestamp stick to the previous record
+        if (!sequenced) {
+            timestampKey(line, size, &key);
+            return true;
+        }
+
+        prefix = sequencePrefix(line, size);
+        if (prefix > 0) {
+            key = QByteArray(line, SequenceDigits);
+        }
+        return true;
+    }
+
+private:
+    struct Span {
+        int begin;
+        int size;
+    };
+
+    // Unordered segment is read whole and its records, continuation lines
+    // included, are stably sorted by prefix
+    bool nextSorted()
+    {
+        if (!loaded)
+        {
+            loaded = true;
+            QByteArray output;
+            while (scanner->take(source, &output)) {
+                chunk.append(output);
+            }
+
+            for (int begin = 0; begin < chunk.size();)
+            {
+                const char *line = chunk.constData() + begin;
+                const int size = int(static_cast<const char *>(memchr(line, '\n', size_t(chunk.size() - begin))) - line) + 1;
+                if (spans.empty() || sequencePrefix(line, size) > 0) {
+                    spans.push_back(Span{ begin, size });
+                } else {
+                    spans.back().size += size;
+                }
+                begin += size;
+            }
+
+            const char *data = chunk.constData();
+            std::stable_sort(spans.begin(), spans.end(), [data](const Span &a, const Span &b) -> bool
+            {
+                const bool keyedA = (sequencePrefix(data + a.begin, a.size) > 0);
+                const bool keyedB = (sequencePrefix(data + b.begin, b.size) > 0);
+                return (keyedA && keyedB ? memcmp(data + a.begin, data + b.begin, SequenceDigits) < 0 : keyedB && !keyedA);
+            });
+        }
+
+        if (pos >= int(spans.size())) {
+            return false;
+        }
+
+        const Span &span = spans.at(size_t(pos++));
+        line = chunk.constData() + span.begin;
+        size = span.size;
+        prefix = sequencePrefix(line, size);
+        if (prefix > 0) {
+            key = QByteArray(line, SequenceDigits);
+        }
+        return true;
+    }
+
+public:
+    Scanner *scanner;
+    int source;
+    bool sequenced;
+    bool sorting;
+    bool loaded = false;
+    QByteArray chunk;
+    int pos = 0;
+    std::vector<Span> spans;
+
+    const char *line = nullptr;
+    int size = 0;
+    int prefix = 0;
+    QByteArray key;
+};
+
+void write(const char *data, int size)
+{
+    fwrite(data, 1, size_t(size), stdout);
+}
+
+void concatenate(Scanner *scanner)
+{
+    QByteArray output;
+    for (int i = 0; i < scanner->sourceCount(); ++i)
+    {
+        while (scanner->take(i, &output)) {
+            write(output.constData(), output.size());
+        }
+    }
+}
+
+void interleave(Scanner *scanner, const Options &options)
+{
+    std::vector<std::unique_ptr<Cursor>> cursors;
+    const auto later = [&cursors](int a, int b) -> bool
+    {
+        const QByteArray &keyA = cursors.at(size_t(a))->key;
+        const QByteArray &keyB = cursors.at(size_t(b))->key;
+        return (keyA != keyB ? keyA > keyB : a > b);
+    };
+    std::priority_queue<int, std::vector<int>, decltype(later)> heads(later);
+
+    for (int i = 0; i < scanner->sourceCount(); ++i)
+    {
+        cursors.push_back(std::unique_ptr<Cursor>(new Cursor(scanner, i, options.sequenced)));
+        if (cursors.back()->next()) {
+            heads.push(i);
+        }
+    }
+
+    while (!heads.empty())
+    {
+        const int head = heads.top();
+        heads.pop();
+
+        Cursor &cursor = *cursors.at(size_t(head));
+        const int skip = (options.keepSequence ? 0 : cursor.prefix);
+        write(cursor.line + skip, cursor.size - skip);
+        if (cursor.next()) {
+            heads.push(head);
+        }
+    }
+}
+
+bool parseOptions(const QStringList &args, Options *options)
+{
+    for (int i = 2; i < args.size(); ++i)
+    {
+        const QString &arg = args.at(i);
+        const bool hasValue = (i + 1 < args.size());
+        if (arg == "-l" && hasValue)
+        {
+            QRegExp rx(args.at(++i));
+            if (rx.indexIn("debug") != -1)    { options->levels |= Debug; }
+            if (rx.indexIn("info") != -1)     { options->levels |= Info; }
+            if (rx.indexIn("warning") != -1)  { options->levels |= Warning; }
+            if (rx.indexIn("critical") != -1) { options->levels |= Critical; }
+            if (rx.indexIn("fatal") != -1)    { options->levels |= Fatal; }
+            if (!options->levels) {
+                return false;
+            }
+        }
+        else if (arg == "-a" && hasValue) { options->app = args.at(++i); }
+        else if (arg == "-f" && hasValue) { options->from = args.at(++i).toLatin1(); }
+        else if (arg == "-t" && hasValue) { options->to = args.at(++i).toLatin1(); }
+        else if (arg == "-e" && hasValue) { options->pattern = args.at(++i); }
+        else if (arg == "-j" && hasValue) { options->threads = qMax(1, args.at(++i).toInt()); }
+        else if (arg == "-s") { options->strip = true; }
+        else if (arg == "-m") { options->merge = true; }
+        else if (arg == "-n" && options->sequenced) { options->keepSequence = true; }
+        else if (arg.startsWith("-")) { return false; }
+        else { options->paths.append(arg); }
+    }
+
+    for (const auto &pattern : { options->app, options->pattern })
+    {
+        if (!QRegularExpression(pattern).isValid()) {
+            fprintf(stderr, "qtl %s: invalid pattern %s\n", qPrintable(args.at(1)), qPrintable(pattern));
+            return false;
+        }
+    }
+    return !options->paths.isEmpty();
+}
+
+int scan(const Options &options)
+{
+    static char buffer[1 << 20];
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+    Scanner scanner(options);
+    if (options.merge) {
+        interleave(&scanner, options);
+    } else {
+        concatenate(&scanner);
+    }
+    fflush(stdout);
+    return (scanner.sourceCount() == options.paths.size() ? 0 : EXIT_FAILURE);
+}
+
+}
+
+int grep(const QStringList &args)
+{
+    Options options;
+    if (!parseOptions(args, &options))
+    {
+        fprintf(stderr, "Usage: qtl grep [-l level] [-a app] [-f from] [-t to] [-e pattern] [-s] [-m] [-j threads] <file> ...\n");
+        return EXIT_FAILURE;
+    }
+    return scan(options);
+}
+
+int merge(const QStringList &args)
+{
+    Options options;
+    options.merge = true;
+    options.sequenced = true;
+    if (!parseOptions(args, &options))
+    {
+        fprintf(stderr, "Usage: qtl merge [-n] [grep options] <base-path | segment-file> ...\n");
+        return EXIT_FAILURE;
+    }
+
+    // A base path stands for all of its <base-path>.tid-<tid> segments
+    QStringList paths;
+    for (const auto &path : options.paths)
+    {
+        const QFileInfo info(path);
+        if (info.isFile() && isSegment(info)) {
+            paths.append(path);
+            continue;
+        }
+
+        for (const auto &segment : info.dir().entryInfoList(QStringList(info.fileName() + "." + SegmentTag + "*"), QDir::Files, QDir::Name))
+        {
+            if (isSegment(segment)) {
+                paths.append(segment.filePath());
+            }
+        }
+    }
+
+    if (paths.isEmpty())
+    {
+        fprintf(stderr, "qtl merge: no segments found\n");
+        return EXIT_FAILURE;
+    }
+    options.paths = paths;
+    return scan(options);
+}
@@ -0,0 +1,9 @@
+#ifndef QTLOGGER_UTILITY_GREP_H
+#define QTLOGGER_UTILITY_GREP_H
+
+#include <QStringList>
+
+int grep(const QStringList &args);
+int merge(const QStringList &args);
+
+#endif // QTLOGGER_UTILITY_GREP_H
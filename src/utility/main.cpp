@@ -1,27 +1,144 @@
 #include <QCoreApplication>
 #include <QUdpSocket>
+#include <QNetworkInterface>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
 #include <QSettings>
+#include <QSharedPointer>
+#include <QTimer>
 
-void listen(QUdpSocket * socket, const QStringList & args)
-{
-    Q_ASSERT(socket);
-    quint16 port = ( (args.count() < 3) ? quint16(QSettings(CONFIG_PATH "/.qtlogger-rc", QSettings::NativeFormat).value("default-dest-port").toInt())
-                                        : args.at(2).toUShort() );
-
-    socket->bind(port, QUdpSocket::ShareAddress);
+#include "blast.h"
+#include "grep.h"
+#include "logger/destination.h"
 
-    qInfo(" ***** Listening on %u *****", port);
+#define MAX_FRAME_BYTES (16 * 1024 * 1024)
 
-    QObject::connect(socket, &QUdpSocket::readyRead, [socket]() -> void
+void print(const QHostAddress &address, const QByteArray &payload, BlastStats *stats)
+{
+    for (const auto &line : payload.split('\n'))
     {
-        QHostAddress address;
-        QByteArray datagram(int(socket->pendingDatagramSize()), 0);
-        socket->readDatagram(datagram.data(), datagram.size(), &address);
+        if (line.isEmpty() || stats->consume(line)) {
+            continue;
+        }
 
         qInfo().noquote() << " *"
                           << address.toString().split(":", QString::SkipEmptyParts).last()
                           << ">>"
-                          << QString::fromLocal8Bit(datagram.data()).simplified();
+                          << QString::fromLocal8Bit(line).simplified();
+    }
+}
+
+QSharedPointer<BlastStats> reportStats(QObject *parent)
+{
+    QSharedPointer<BlastStats> stats(new BlastStats);
+
+    QTimer *reportTimer = new QTimer(parent);
+    QObject::connect(reportTimer, &QTimer::timeout, [stats]() -> void
+    {
+        const bool idle = stats->isIdle();
+        const QString &report = stats->report();
+        if (!idle) {
+            qInfo().noquote() << " *****" << report;
+        }
+    });
+    reportTimer->start(1000);
+    return stats;
+}
+
+bool listen(QUdpSocket * socket, const QStringList & args)
+{
+    Q_ASSERT(socket);
+    QHostAddress group;
+    quint16 port = quint16(QSettings(CONFIG_PATH "/.qtlogger-rc", QSettings::NativeFormat).value("default-dest-port").toInt());
+    if (!qtlogger::parseDestination(args.value(2), &group, &port)) {
+        qCritical(" ***** Invalid destination \"%s\", expected [multicast-group:][port] *****", qPrintable(args.value(2)));
+        return false;
+    }
+
+    if (!group.isMulticast())
+    {
+        socket->bind(port, QUdpSocket::ShareAddress);
+        qInfo(" ***** Listening on %u *****", port);
+    }
+    else
+    {
+        const QHostAddress any( (group.protocol() == QAbstractSocket::IPv6Protocol) ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4 );
+        socket->bind(any, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint);
+
+        const auto &networkInterface = QNetworkInterface::interfaceFromName(args.value(3));
+        const bool joined = ( networkInterface.isValid() ? socket->joinMulticastGroup(group, networkInterface)
+                                                         : socket->joinMulticastGroup(group) );
+        if (!joined) {
+            qCritical(" ***** Joining %s failed, %s *****", qPrintable(group.toString()), qPrintable(socket->errorString()));
+        }
+        qInfo(" ***** Listening on %s:%u %s *****", qPrintable(group.toString()), port, qPrintable(networkInterface.name()));
+    }
+
+    const auto &stats = reportStats(socket);
+    QObject::connect(socket, &QUdpSocket::readyRead, [socket, stats]() -> void
+    {
+        while (socket->hasPendingDatagrams())
+        {
+            QHostAddress address;
+            QByteArray datagram(int(socket->pendingDatagramSize()), 0);
+            socket->readDatagram(datagram.data(), datagram.size(), &address);
+            print(address, datagram, stats.data());
+        }
+    });
+    return true;
+}
+
+void listenTcp(QTcpServer * server, const QStringList & args)
+{
+    Q_ASSERT(server);
+    quint16 port = ( (args.count() < 4) ? quint16(QSettings(CONFIG_PATH "/.qtlogger-rc", QSettings::NativeFormat).value("default-dest-port").toInt())
+                                        : args.at(3).toUShort() );
+
+    if (!server->listen(QHostAddress::Any, port)) {
+        qCritical(" ***** Listening on tcp %u failed, %s *****", port, qPrintable(server->errorString()));
+        return;
+    }
+
+    qInfo(" ***** Listening on tcp %u *****", port);
+
+    const auto &stats = reportStats(server);
+    QObject::connect(server, &QTcpServer::newConnection, [server, stats]() -> void
+    {
+        while (QTcpSocket *client = server->nextPendingConnection())
+        {
+            const QHostAddress address = client->peerAddress();
+            qInfo(" ***** %s connected *****", qPrintable(address.toString()));
+
+            QSharedPointer<QByteArray> buffer(new QByteArray);
+            QObject::connect(client, &QTcpSocket::readyRead, [client, address, buffer, stats]() -> void
+            {
+                buffer->append(client->readAll());
+
+                int offset = 0;
+                while (buffer->size() - offset >= 4)
+                {
+                    const auto length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(buffer->constData() + offset));
+                    if (length > MAX_FRAME_BYTES) {
+                        qWarning(" ***** %s sent malformed frame, dropping connection *****", qPrintable(address.toString()));
+                        buffer->clear();
+                        client->abort();
+                        return;
+                    }
+                    if (quint32(buffer->size() - offset - 4) < length) {
+                        break;
+                    }
+                    print(address, buffer->mid(offset + 4, int(length)), stats.data());
+                    offset += 4 + int(length);
+                }
+                buffer->remove(0, offset);
+            });
+            QObject::connect(client, &QTcpSocket::disconnected, [client, address]() -> void
+            {
+                qInfo(" ***** %s disconnected *****", qPrintable(address.toString()));
+                client->deleteLater();
+            });
+        }
     });
 }
 
@@ -38,8 +155,32 @@ int main(int argc, char *argv[])
     if (argc < 2) {
         qInfo("Usage: %s <command> [args]\n\n"
               "LISTENER MODE\n"
-              "  listen [port]\n"
-              "      Listen on port [port] or default dest port from .qtlogger-rc\n\n"
+              "  listen [multicast-group:][port] [interface]\n"
+              "      Listen on port [port] or default dest port from .qtlogger-rc, joining\n"
+              "      [multicast-group] on [interface] or on default interface if specified.\n"
+              "      IPv6 groups are written in brackets, e.g. [ff15::1]:6061\n"
+              "  listen tcp [port]\n"
+              "      Accept \"echo tcp\" clients on port [port] or default dest port from .qtlogger-rc\n\n"
+              "LOAD GENERATOR MODE\n"
+              "  blast [udp | tcp] [address:][port] [rate] [size] [senders] [duration-sec]\n"
+              "      Send sequenced synthetic log lines over udp (default) or tcp, one connection per\n"
+              "      sender, to [address:][port] or local host and\n"
+              "      default dest port from .qtlogger-rc at [rate] msg/s (10000) split between\n"
+              "      [senders] threads (1) during [duration-sec] (10). [size] is line length in\n"
+              "      bytes (128) or <min>-<max> for uniformly distributed lengths. Listener\n"
+              "      reports throughput, latency and loss of received lines every second\n"
+              "  blast command <burst-size> <bursts> <period-msec> \"[hostname:]<app>\" <command> [args]\n"
+              "      Send <bursts> bursts of <burst-size> commands every <period-msec>\n\n"
+              "OFFLINE MODE\n"
+              "  grep [-l level] [-a app] [-f from] [-t to] [-e pattern] [-s] [-m] [-j threads] <file> ...\n"
+              "      Scan log files in parallel chunks printing lines of <level> regex, from <app>\n"
+              "      regex, with time between <from> and <to> (hh:mm:ss[.uuuuuu], prefix inclusive)\n"
+              "      and message matching <pattern>. Colour codes are stripped with -s. Files\n"
+              "      are printed one after another in original line order, or merged by\n"
+              "      timestamp into one stream with -m\n"
+              "  merge [-n] [grep options] <base-path | segment-file> ...\n"
+              "      Merge per thread \"echo split\" segments <base-path>.tid-<tid> into one stream\n"
+              "      ordered by their monotonic timestamps, keeping them with -n\n\n"
               "COMMAND MODE\n"
               "  \"[hostname:]<app>\" <command> [args]\n"
               "  \"[hostname:]<app>\" is a client endpoint string\n"
@@ -47,10 +188,20 @@ int main(int argc, char *argv[])
               "  commands:\n"
               "    status [address:][port]\n"
               "      Request for clients status on [address:][port] or on sender\n"
-              "      address and default dest port from .qtlogger-rc\n\n"
+              "      address and default dest port from .qtlogger-rc\n"
+              "    top [count] [address:][port]\n"
+              "      Request for [count] busiest call sites (10 by default) with hit rate,\n"
+              "      emitted and filtered messages on [address:][port] or on sender\n"
+              "    scopes [address:][port]\n"
+              "      Request for QTLOG_SCOPE duration percentiles on [address:][port] or on sender\n"
+              "    scopes summary <period-msec>\n"
+              "      Log percentiles of every scope each <period-msec>, 0 to stop\n"
+              "    budget <messages/s> [bytes/s] | off\n"
+              "      Shed debug, then info messages and rate limit warnings while\n"
+              "      logging exceeds the budget\n\n"
               "  redirecting commands:\n"
               "    echo <mode> [args]\n"
-              "    <mode> = mute | stderr | file | udp\n"
+              "    <mode> = mute | stderr | file | split | udp | tcp\n"
               "      mute\n"
               "        Mute client\n"
               "      stderr\n"
@@ -58,9 +209,17 @@ int main(int argc, char *argv[])
               "      file [file-path] [flush-period-msec]\n"
               "        Redirect client output to file [file-path] with flush period [flush-period-msec]\n"
               "        or %s.log with default flush period from .qtlogger-rc\n"
-              "      udp [address:][port]\n"
+              "      split [base-path] [flush-period-msec]\n"
+              "        Like file, but every thread writes own [base-path].tid-<tid> segment\n"
+              "        without locking, lines are prefixed by monotonic nanoseconds\n"
+              "      udp [address:][port] [ttl] [interface]\n"
               "        Redirect client output to [address:][port] or on sender\n"
-              "        address and default dest port from .qtlogger-rc\n\n"
+              "        address and default dest port from .qtlogger-rc. For multicast [address]\n"
+              "        datagrams are sent with [ttl] or default multicast ttl from .qtlogger-rc\n"
+              "        through [interface] or default multicast route\n"
+              "      tcp [address:][port]\n"
+              "        Stream client output to [address:][port] or on sender address and default\n"
+              "        dest port from .qtlogger-rc, spilling to disk while disconnected\n\n"
               "  filtering commands:\n"
               "    filter <operation> [type] [arg]\n"
               "    <operation> = add | del | clear\n"
@@ -70,13 +229,16 @@ int main(int argc, char *argv[])
               "        Delete filter [type]\n"
               "      clear\n"
               "        Clear all filters with [type] or all if no one specified\n"
-              "    <type> = level | file | function\n"
+              "    <type> = level | file | function | message\n"
               "      level <name>\n"
               "        <name> = info | debug | warning | critical | fatal\n"
               "      file <name>\n"
               "        Filter by file <name> where log message has been posted\n"
               "      function <name>\n"
-              "        Filter by function <name> where log message has been posted\n\n"
+              "        Filter by function <name> where log message has been posted\n"
+              "      message <pattern>\n"
+              "        Filter by log message text matching <pattern>, write regex\n"
+              "        alternation as \\| since | separates commands\n\n"
               "EXAMPLES\n"
               "  Request for all clients status\n"
               "    %s \".*\" status\n"
@@ -94,6 +256,25 @@ int main(int argc, char *argv[])
     QCoreApplication app(argc, argv);
     const auto & args = app.arguments();
 
+    if (args.at(1) == QString("blast")) {
+        return ( (args.value(2) == QString("command")) ? blastCommands(args)
+                                                        : blast(args) );
+    }
+
+    if (args.at(1) == QString("grep")) {
+        return grep(args);
+    }
+
+    if (args.at(1) == QString("merge")) {
+        return merge(args);
+    }
+
+    if (args.at(1) == QString("listen") && args.value(2) == QString("tcp")) {
+        QTcpServer server;
+        listenTcp(&server, args);
+        return (server.isListening() ? app.exec() : EXIT_FAILURE);
+    }
+
     QUdpSocket socket;
 
     if (args.at(1) != QString("listen")) {
@@ -103,6 +284,5 @@ int main(int argc, char *argv[])
         return result;
     }
 
-    listen(&socket, args);
-    return app.exec();
+    return (listen(&socket, args) ? app.exec() : EXIT_FAILURE);
 }